@@ -0,0 +1,21 @@
+#!/usr/bin/env bash
+# Runs every example that has an expected output file (NAME.out) with and
+# without optimizations and compares what it prints to stdout.
+# Usage: Examples/check.sh [PATH_TO_ASMS]
+
+ASMS=${1:-./build/asms}
+DIR=$(dirname "$0")
+
+status=0
+for expected in "$DIR"/*.out; do
+	program=${expected%.out}.asms
+	for level in 0 1; do
+		if "$ASMS" --opt-level "$level" "$program" 2> /dev/null | diff -u "$expected" - > /dev/null; then
+			printf '%-40s ok\n' "$(basename "$program") --opt-level $level"
+		else
+			printf '%-40s FAILED\n' "$(basename "$program") --opt-level $level"
+			status=1
+		fi
+	done
+done
+exit $status
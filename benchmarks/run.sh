@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+# Times the benchmark programs with different runtime configurations.
+# Usage: benchmarks/run.sh [PATH_TO_ASMS]
+set -e
+
+ASMS=${1:-./build/asms}
+DIR=$(dirname "$0")
+
+INPUT=$(mktemp)
+OUTPUT=$(mktemp)
+trap 'rm -f "$INPUT" "$OUTPUT"' EXIT
+
+run() {
+	local label=$1
+	shift
+	local start end
+	start=$(date +%s%N)
+	"$ASMS" "$@" < "$INPUT" > "${STDOUT:-/dev/null}"
+	end=$(date +%s%N)
+	printf '%-40s %6d ms\n' "$label" $(((end - start) / 1000000))
+}
+
+echo "print_numbers.asms"
+run "  stdio per value (--output-buffer 0)" --output-buffer 0 "$DIR/print_numbers.asms"
+run "  buffered, 64K" --output-buffer 64K "$DIR/print_numbers.asms"
+run "  buffered, runtime call per number" --no-inline-print "$DIR/print_numbers.asms"
+run "  buffered, 1M (default)" "$DIR/print_numbers.asms"
+run "  freestanding, write(2) per flush" --freestanding "$DIR/print_numbers.asms"
+
+echo "print_numbers.asms, written to a file"
+STDOUT=$OUTPUT run "  stdout redirected to the file" "$DIR/print_numbers.asms"
+run "  --output FILE (memory-mapped)" --output "$OUTPUT" "$DIR/print_numbers.asms"
+
+echo "sum_input.asms (10 million integers)"
+seq -5000000 4999999 > "$INPUT"
+run "  1M read-ahead (default)" "$DIR/sum_input.asms"
+run "  4K read-ahead" --input-buffer 4K "$DIR/sum_input.asms"
+
+echo "recursion.asms (64 MiB of stack)"
+run "  128M stack" --stack-size 128M "$DIR/recursion.asms"
+run "  128M stack, huge pages" --stack-size 128M --huge-stack "$DIR/recursion.asms"
+run "  128M stack, all optimizations off" --stack-size 128M --opt-level 0 "$DIR/recursion.asms"
+
+echo "alloc.asms (100 million allocations)"
+run "  default" "$DIR/alloc.asms"
+run "  freestanding" --freestanding "$DIR/alloc.asms"
+
+echo "memory.asms (copy, fill, compare and find)"
+run "  default" "$DIR/memory.asms"
+
+echo "count.asms (hash table, 10 million increments)"
+run "  default" "$DIR/count.asms"
+
+echo "divide.asms (division and modulo by constants)"
+run "  default" "$DIR/divide.asms"
+
+echo "gcd.asms (remainder of two registers, 9 million pairs)"
+run "  default" "$DIR/gcd.asms"
+run "  all optimizations off (--opt-level 0)" --opt-level 0 "$DIR/gcd.asms"
@@ -1,6 +1,9 @@
 
 #include "common.h"
+#include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 
 namespace Runtime {
 	
@@ -21,6 +24,38 @@ namespace Runtime {
 		return true;
 	}
 	
+	/* NOTE Accepts a decimal byte count with an optional K, M or G suffix
+	 * (powers of 1024).
+	 */
+	bool ParseSize(const char *const text, size_t &out) {
+		if (*text < '0' || *text > '9') return false;
+		
+		char *end;
+		errno = 0;
+		unsigned long long value = strtoull(text, &end, 10);
+		if (errno != 0) return false;
+		
+		unsigned shift = 0;
+		switch (*end) {
+			case '\0': break;
+			case 'K':
+			case 'k': shift = 10;
+				break;
+			case 'M':
+			case 'm': shift = 20;
+				break;
+			case 'G':
+			case 'g': shift = 30;
+				break;
+			default: return false;
+		}
+		if (shift != 0 && end[1] != '\0') return false;
+		if (value > (SIZE_MAX >> shift)) return false;
+		
+		out = static_cast<size_t>(value) << shift;
+		return true;
+	}
+	
 	std::string Format(const char *const fmt, ...) {
 		va_list args;
 		va_start(args, fmt);
@@ -6,6 +6,8 @@
 namespace Runtime {
 	bool ReadFile(const char *filepath, std::string &out);
 	
+	bool ParseSize(const char *text, size_t &out);
+	
 	__attribute__ ((format (printf, 1, 2)))
 	std::string Format(const char *fmt, ...);
 	
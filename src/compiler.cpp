@@ -1,10 +1,29 @@
 #include "common.h"
 #include "compiler.h"
+#include "liveness.h"
+#include "peephole.h"
 #include "parser.h"
 #include "runtime.h"
 
 namespace Compiler {
 	
+	/* NOTE Literals live in a read-only section placed after the code, so the
+	 * code reaching them stays straight-line. Identical literals share storage.
+	 * 64 bit immediates that don't fit an instruction are pooled the same way.
+	 * State owned by the generated code itself lives in a writable section on
+	 * the following page. Each reference is a RIP-relative displacement patched
+	 * once the code size is known.
+	 */
+	static MachineCode rodata;
+	static MachineCode writable;
+	static std::unordered_map<std::string, size_t> stringPool;
+	static std::unordered_map<int64_t, size_t> constantPool;
+	static std::vector<SectionRef> sectionRefs;
+	
+	size_t AddString(const std::string &text);
+	
+	size_t AddConstant(int64_t value);
+	
 	namespace Gen {
 		
 		// --- EMIT HELPERS
@@ -17,6 +36,11 @@ namespace Compiler {
 			code.push_back(0x41);
 		}
 		
+		void EmitRex(const bool w, const bool r, const bool x, const bool b, MachineCode &code) {
+			if (!w && !r && !x && !b) return;
+			code.push_back(0x40 | (w << 3) | (r << 2) | (x << 1) | (b << 0));
+		}
+		
 		void EmitModRM(const uint8_t mod, const uint8_t reg, const uint8_t rm, MachineCode &code) {
 			const uint8_t byte = (mod << 6) | (reg << 3) | (rm << 0);
 			code.push_back(byte);
@@ -79,6 +103,18 @@ namespace Compiler {
 			EmitPop(Register::rax, code);
 		}
 		
+		void EmitPushRegs(const RegisterSet regs, MachineCode &code) {
+			for (uint8_t i = 0; i < 16; ++i) {
+				if (regs & (1u << i)) EmitPush(static_cast<Register>(i), code);
+			}
+		}
+		
+		void EmitPopRegs(const RegisterSet regs, MachineCode &code) {
+			for (uint8_t i = 16; i-- > 0;) {
+				if (regs & (1u << i)) EmitPop(static_cast<Register>(i), code);
+			}
+		}
+		
 		// --- EMIT FULL INSTRUCTION
 		
 		void EmitMov(const Register dest, const Register source, MachineCode &code) {
@@ -90,12 +126,29 @@ namespace Compiler {
 			EmitModRM(0b11, srcval & 0x07, destval & 0x07, code);
 		}
 		
+		/* NOTE Uses the shortest encoding: a 32 bit mov, which zero-extends, for
+		 * values that fit in 32 bits unsigned, a sign-extended 32 bit immediate for
+		 * other values that fit and movabs for the rest. Flags are left alone.
+		 */
 		void EmitMov(const Register dest, const int64_t value, MachineCode &code) {
 			const auto destval = static_cast<uint8_t>(dest);
 			
-			EmitRexW(false, destval & 0x08, code);
-			code.push_back(0xB8 | (destval & 0x07));
-			EmitImm64(value, code);
+			if (value >= 0 && value <= INT64_C(0xFFFFFFFF)) {
+				if (destval & 0x08) EmitRexB(code);
+				code.push_back(0xB8 | (destval & 0x07));
+				EmitImm32(static_cast<int32_t>(static_cast<uint32_t>(value)), code);
+			}
+			else if (value >= INT32_MIN && value <= INT32_MAX) {
+				EmitRexW(false, destval & 0x08, code);
+				code.push_back(0xC7);
+				EmitModRM(0b11, 0, destval & 0x07, code);
+				EmitImm32(static_cast<int32_t>(value), code);
+			}
+			else {
+				EmitRexW(false, destval & 0x08, code);
+				code.push_back(0xB8 | (destval & 0x07));
+				EmitImm64(value, code);
+			}
 		}
 		
 		void EmitLea(const Register dest, const size_t to, MachineCode &code) {
@@ -110,6 +163,38 @@ namespace Compiler {
 			EmitImm32(diff, code);
 		}
 		
+		void EmitLea(const Register dest, const Register base, const Register index, const uint8_t scale, const int32_t disp, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto baseval = static_cast<uint8_t>(base);
+			const auto indexval = static_cast<uint8_t>(index);
+			
+			uint8_t mod = 0b10;
+			if (disp == 0 && (baseval & 0x07) != 0b101) mod = 0b00;
+			else if (disp >= -128 && disp <= 127) mod = 0b01;
+			
+			EmitRex(true, destval & 0x08, indexval & 0x08, baseval & 0x08, code);
+			code.push_back(0x8D);
+			EmitModRM(mod, destval & 0x07, 0b100, code);
+			EmitSIB(scale, indexval & 0x07, baseval & 0x07, code);
+			
+			if (mod == 0b01) EmitImm8(static_cast<int8_t>(disp), code);
+			else if (mod == 0b10) EmitImm32(disp, code);
+		}
+		
+		void EmitRipOperand(const uint8_t reg, const Section section, const size_t dataPtr, MachineCode &code) {
+			EmitModRM(0b00, reg & 0x07, 5, code);
+			sectionRefs.push_back(SectionRef{code.length(), section, dataPtr});
+			EmitImm32(0, code);
+		}
+		
+		void EmitLeaData(const Register dest, const Section section, const size_t dataPtr, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			
+			EmitRexW(destval & 0x08, false, code);
+			code.push_back(0x8D);
+			EmitRipOperand(destval, section, dataPtr, code);
+		}
+		
 		void EmitMovStack(const Register dest, const int64_t stackOffset, MachineCode &code) {
 			const auto destval = static_cast<uint8_t>(dest);
 			int64_t disp = stackOffset * 8;
@@ -148,6 +233,134 @@ namespace Compiler {
 			}
 		}
 		
+		void EmitLeaStack(const Register dest, const int64_t stackOffset, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			int64_t disp = stackOffset * 8;
+			
+			EmitRexW(destval & 0x08, false, code);
+			code.push_back(0x8D);
+			
+			if (disp >= INT64_C(-128) && disp <= INT64_C(127)) {
+				EmitModRM(0b01, destval & 0x07, 0b100, code);
+				EmitSIB(0b00, 0b100, 0x04, code);
+				EmitImm8(static_cast<int8_t>(disp), code);
+			}
+			else {
+				EmitModRM(0b10, destval & 0x07, 0b100, code);
+				EmitSIB(0b00, 0b100, 0x04, code);
+				EmitImm32(static_cast<int32_t>(disp), code);
+			}
+		}
+		
+		void EmitMemOperand(const uint8_t reg, const Register base, const int32_t disp, MachineCode &code) {
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			uint8_t mod = 0b10;
+			if (disp == 0 && (baseval & 0x07) != 0b101) mod = 0b00;
+			else if (disp >= -128 && disp <= 127) mod = 0b01;
+			
+			EmitModRM(mod, reg & 0x07, baseval & 0x07, code);
+			if ((baseval & 0x07) == 0b100) EmitSIB(0b00, 0b100, 0b100, code);
+			
+			if (mod == 0b01) EmitImm8(static_cast<int8_t>(disp), code);
+			else if (mod == 0b10) EmitImm32(disp, code);
+		}
+		
+		void EmitMovLoad(const Register dest, const Register base, const int32_t disp, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRexW(destval & 0x08, baseval & 0x08, code);
+			code.push_back(0x8B);
+			EmitMemOperand(destval, base, disp, code);
+		}
+		
+		void EmitMovStore(const Register base, const int32_t disp, const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRexW(srcval & 0x08, baseval & 0x08, code);
+			code.push_back(0x89);
+			EmitMemOperand(srcval, base, disp, code);
+		}
+		
+		void EmitLea(const Register dest, const Register base, const int32_t disp, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRexW(destval & 0x08, baseval & 0x08, code);
+			code.push_back(0x8D);
+			EmitMemOperand(destval, base, disp, code);
+		}
+		
+		void EmitMovzxWordLoad(const Register dest, const Register base, const Register index, const uint8_t scale, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto baseval = static_cast<uint8_t>(base);
+			const auto indexval = static_cast<uint8_t>(index);
+			
+			EmitRex(false, destval & 0x08, indexval & 0x08, baseval & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0xB7);
+			if ((baseval & 0x07) == 0b101) {
+				EmitModRM(0b01, destval & 0x07, 0b100, code);
+				EmitSIB(scale, indexval & 0x07, baseval & 0x07, code);
+				EmitImm8(0, code);
+			}
+			else {
+				EmitModRM(0b00, destval & 0x07, 0b100, code);
+				EmitSIB(scale, indexval & 0x07, baseval & 0x07, code);
+			}
+		}
+		
+		void EmitMovWordStore(const Register base, const int32_t disp, const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			code.push_back(0x66);
+			EmitRex(false, srcval & 0x08, false, baseval & 0x08, code);
+			code.push_back(0x89);
+			EmitMemOperand(srcval, base, disp, code);
+		}
+		
+		void EmitMovByteStore(const Register base, const int32_t disp, const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			// Without REX, 4-7 would encode ah, ch, dh and bh instead of spl, bpl, sil and dil.
+			if (srcval >= 4 || (baseval & 0x08)) code.push_back(0x40 | ((srcval & 0x08) >> 1) | ((baseval & 0x08) >> 3));
+			code.push_back(0x88);
+			EmitMemOperand(srcval, base, disp, code);
+		}
+		
+		void EmitMovByteStore(const Register base, const int32_t disp, const int8_t value, MachineCode &code) {
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRex(false, false, false, baseval & 0x08, code);
+			code.push_back(0xC6);
+			EmitMemOperand(0, base, disp, code);
+			EmitImm8(value, code);
+		}
+		
+		void EmitMovdquLoad(const uint8_t dest, const Register base, const int32_t disp, MachineCode &code) {
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			code.push_back(0xF3);
+			EmitRex(false, dest & 0x08, false, baseval & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0x6F);
+			EmitMemOperand(dest, base, disp, code);
+		}
+		
+		void EmitMovdquStore(const Register base, const int32_t disp, const uint8_t source, MachineCode &code) {
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			code.push_back(0xF3);
+			EmitRex(false, source & 0x08, false, baseval & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0x7F);
+			EmitMemOperand(source, base, disp, code);
+		}
+		
 		void EmitAdd(const Register dest, const Register source, MachineCode &code) {
 			const auto destval = static_cast<uint8_t>(dest);
 			const auto srcval = static_cast<uint8_t>(source);
@@ -173,11 +386,9 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(value), code);
 			}
 			else {
-				Register tmp = dest != Register::rax ? Register::rax : Register::rbx;
-				EmitMovStack(-1, tmp, code);
-				EmitMov(tmp, value, code);
-				EmitAdd(dest, tmp, code);
-				EmitMovStack(tmp, -1, code);
+				EmitRexW(destval & 0x08, false, code);
+				code.push_back(0x03);
+				EmitRipOperand(destval, Section::ReadOnly, AddConstant(value), code);
 			}
 		}
 		
@@ -206,11 +417,9 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(value), code);
 			}
 			else {
-				Register tmp = dest != Register::rax ? Register::rax : Register::rbx;
-				EmitMovStack(-1, tmp, code);
-				EmitMov(tmp, value, code);
-				EmitSub(dest, tmp, code);
-				EmitMovStack(tmp, -1, code);
+				EmitRexW(destval & 0x08, false, code);
+				code.push_back(0x2B);
+				EmitRipOperand(destval, Section::ReadOnly, AddConstant(value), code);
 			}
 		}
 		
@@ -239,14 +448,22 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(value), code);
 			}
 			else {
-				Register tmp = dest != Register::rax ? Register::rax : Register::rbx;
-				EmitMovStack(-1, tmp, code);
-				EmitMov(tmp, value, code);
-				EmitAnd(dest, tmp, code);
-				EmitMovStack(tmp, -1, code);
+				EmitRexW(destval & 0x08, false, code);
+				code.push_back(0x23);
+				EmitRipOperand(destval, Section::ReadOnly, AddConstant(value), code);
 			}
 		}
 		
+		// Also clears the upper half of dest
+		void EmitXor32(const Register dest, const Register source, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto srcval = static_cast<uint8_t>(source);
+			
+			EmitRex(false, srcval & 0x08, false, destval & 0x08, code);
+			code.push_back(0x31);
+			EmitModRM(0b11, srcval & 0x07, destval & 0x07, code);
+		}
+		
 		void EmitOr(const Register dest, const Register source, MachineCode &code) {
 			const auto destval = static_cast<uint8_t>(dest);
 			const auto srcval = static_cast<uint8_t>(source);
@@ -272,11 +489,9 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(value), code);
 			}
 			else {
-				Register tmp = dest != Register::rax ? Register::rax : Register::rbx;
-				EmitMovStack(-1, tmp, code);
-				EmitMov(tmp, value, code);
-				EmitOr(dest, tmp, code);
-				EmitMovStack(tmp, -1, code);
+				EmitRexW(destval & 0x08, false, code);
+				code.push_back(0x0B);
+				EmitRipOperand(destval, Section::ReadOnly, AddConstant(value), code);
 			}
 		}
 		
@@ -305,11 +520,9 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(value), code);
 			}
 			else {
-				Register tmp = dest != Register::rax ? Register::rax : Register::rbx;
-				EmitMovStack(-1, tmp, code);
-				EmitMov(tmp, value, code);
-				EmitXor(dest, tmp, code);
-				EmitMovStack(tmp, -1, code);
+				EmitRexW(destval & 0x08, false, code);
+				code.push_back(0x33);
+				EmitRipOperand(destval, Section::ReadOnly, AddConstant(value), code);
 			}
 		}
 		
@@ -340,8 +553,11 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(value), code);
 			}
 			else {
-				EmitMov(dest, value, code);
-				EmitImul(dest, source, code);
+				if (dest != source) EmitMov(dest, source, code);
+				EmitRexW(destval & 0x08, false, code);
+				code.push_back(0x0F);
+				code.push_back(0xAF);
+				EmitRipOperand(destval, Section::ReadOnly, AddConstant(value), code);
 			}
 		}
 		
@@ -352,6 +568,75 @@ namespace Compiler {
 			EmitModRM(0b11, 7, divisorval & 0x07, code);
 		}
 		
+		// edx:eax / source, unsigned, quotient in eax and remainder in edx
+		void EmitDiv32(const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			EmitRex(false, false, false, srcval & 0x08, code);
+			code.push_back(0xF7);
+			EmitModRM(0b11, 6, srcval & 0x07, code);
+		}
+		
+		// Sign-extends rax into rdx
+		void EmitCqo(MachineCode &code) {
+			EmitRexW(false, false, code);
+			code.push_back(0x99);
+		}
+		
+		void EmitMul(const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			EmitRexW(false, srcval & 0x08, code);
+			code.push_back(0xF7);
+			EmitModRM(0b11, 4, srcval & 0x07, code);
+		}
+		
+		// rdx:rax = rax * source, signed
+		void EmitImul(const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			EmitRexW(false, srcval & 0x08, code);
+			code.push_back(0xF7);
+			EmitModRM(0b11, 5, srcval & 0x07, code);
+		}
+		
+		void EmitNeg(const Register dest, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			EmitRexW(false, destval & 0x08, code);
+			code.push_back(0xF7);
+			EmitModRM(0b11, 3, destval & 0x07, code);
+		}
+		
+		void EmitShr(const Register dest, const uint8_t count, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			EmitRexW(false, destval & 0x08, code);
+			code.push_back(0xC1);
+			EmitModRM(0b11, 5, destval & 0x07, code);
+			code.push_back(count);
+		}
+		
+		void EmitShl(const Register dest, const uint8_t count, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			EmitRexW(false, destval & 0x08, code);
+			code.push_back(0xC1);
+			EmitModRM(0b11, 4, destval & 0x07, code);
+			code.push_back(count);
+		}
+		
+		void EmitSar(const Register dest, const uint8_t count, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			EmitRexW(false, destval & 0x08, code);
+			code.push_back(0xC1);
+			EmitModRM(0b11, 7, destval & 0x07, code);
+			code.push_back(count);
+		}
+		
+		void EmitTest(const Register a, const Register b, MachineCode &code) {
+			const auto aval = static_cast<uint8_t>(a);
+			const auto bval = static_cast<uint8_t>(b);
+			
+			EmitRexW(bval & 0x08, aval & 0x08, code);
+			code.push_back(0x85);
+			EmitModRM(0b11, bval & 0x07, aval & 0x07, code);
+		}
+		
 		void EmitCmp(const Register a, const Register b, MachineCode &code, bool &inverted) {
 			const auto aval = static_cast<uint8_t>(a);
 			const auto bval = static_cast<uint8_t>(b);
@@ -379,12 +664,12 @@ namespace Compiler {
 				EmitImm32(static_cast<int32_t>(b), code);
 			}
 			else {
-				Register tmp = a != Register::rax ? Register::rax : Register::rbx;
-				EmitMovStack(-1, tmp, code);
-				EmitMov(tmp, b, code);
-				EmitCmp(a, tmp, code, inverted);
-				EmitMovStack(tmp, -1, code);
+				EmitRexW(aval & 0x08, false, code);
+				code.push_back(0x3B);
+				EmitRipOperand(aval, Section::ReadOnly, AddConstant(b), code);
 			}
+			
+			(void) inverted;
 		}
 		
 		void EmitCmp(const int64_t a, const Register b, MachineCode &code, bool &inverted) {
@@ -392,6 +677,140 @@ namespace Compiler {
 			EmitCmp(b, a, code, inverted);
 		}
 		
+		void EmitCmpLoad(const Register a, const Register base, const int32_t disp, MachineCode &code) {
+			const auto aval = static_cast<uint8_t>(a);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRexW(aval & 0x08, baseval & 0x08, code);
+			code.push_back(0x3B);
+			EmitMemOperand(aval, base, disp, code);
+		}
+		
+		void EmitRepMovsb(MachineCode &code) {
+			code.push_back(0xF3);
+			code.push_back(0xA4);
+		}
+		
+		void EmitRepStosb(MachineCode &code) {
+			code.push_back(0xF3);
+			code.push_back(0xAA);
+		}
+		
+		void EmitMovzxByteLoad(const Register dest, const Register base, const int32_t disp, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRex(false, destval & 0x08, false, baseval & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0xB6);
+			EmitMemOperand(destval, base, disp, code);
+		}
+		
+		void EmitCmpByteLoad(const Register a, const Register base, const int32_t disp, MachineCode &code) {
+			const auto aval = static_cast<uint8_t>(a);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			// Without REX, 4-7 would encode ah, ch, dh and bh instead of spl, bpl, sil and dil.
+			if (aval >= 4 || (baseval & 0x08)) code.push_back(0x40 | ((aval & 0x08) >> 1) | ((baseval & 0x08) >> 3));
+			code.push_back(0x3A);
+			EmitMemOperand(aval, base, disp, code);
+		}
+		
+		void EmitPcmpeqb(const uint8_t dest, const uint8_t source, MachineCode &code) {
+			code.push_back(0x66);
+			EmitRex(false, dest & 0x08, false, source & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0x74);
+			EmitModRM(0b11, dest & 0x07, source & 0x07, code);
+		}
+		
+		void EmitPmovmskb(const Register dest, const uint8_t source, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			
+			code.push_back(0x66);
+			EmitRex(false, destval & 0x08, false, source & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0xD7);
+			EmitModRM(0b11, destval & 0x07, source & 0x07, code);
+		}
+		
+		void EmitMovq(const uint8_t dest, const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			
+			code.push_back(0x66);
+			EmitRex(true, dest & 0x08, false, srcval & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0x6E);
+			EmitModRM(0b11, dest & 0x07, srcval & 0x07, code);
+		}
+		
+		void EmitPunpcklqdq(const uint8_t dest, const uint8_t source, MachineCode &code) {
+			code.push_back(0x66);
+			EmitRex(false, dest & 0x08, false, source & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0x6C);
+			EmitModRM(0b11, dest & 0x07, source & 0x07, code);
+		}
+		
+		void EmitBsf(const Register dest, const Register source, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto srcval = static_cast<uint8_t>(source);
+			
+			EmitRexW(destval & 0x08, srcval & 0x08, code);
+			code.push_back(0x0F);
+			code.push_back(0xBC);
+			EmitModRM(0b11, destval & 0x07, srcval & 0x07, code);
+		}
+		
+		void EmitMovdLoad(const Register dest, const Register base, const int32_t disp, MachineCode &code) {
+			const auto destval = static_cast<uint8_t>(dest);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRex(false, destval & 0x08, false, baseval & 0x08, code);
+			code.push_back(0x8B);
+			EmitMemOperand(destval, base, disp, code);
+		}
+		
+		void EmitMovdStore(const Register base, const int32_t disp, const Register source, MachineCode &code) {
+			const auto srcval = static_cast<uint8_t>(source);
+			const auto baseval = static_cast<uint8_t>(base);
+			
+			EmitRex(false, srcval & 0x08, false, baseval & 0x08, code);
+			code.push_back(0x89);
+			EmitMemOperand(srcval, base, disp, code);
+		}
+		
+		void EmitLfence(MachineCode &code) {
+			code.push_back(0x0F);
+			code.push_back(0xAE);
+			code.push_back(0xE8);
+		}
+		
+		void EmitRdtsc(MachineCode &code) {
+			code.push_back(0x0F);
+			code.push_back(0x31);
+		}
+		
+		void EmitRdtscp(MachineCode &code) {
+			code.push_back(0x0F);
+			code.push_back(0x01);
+			code.push_back(0xF9);
+		}
+		
+		void EmitSyscall(MachineCode &code) {
+			code.push_back(0x0F);
+			code.push_back(0x05);
+		}
+		
+		void EmitXchg(const Register a, const Register b, MachineCode &code) {
+			const auto aval = static_cast<uint8_t>(a);
+			const auto bval = static_cast<uint8_t>(b);
+			
+			EmitRexW(bval & 0x08, aval & 0x08, code);
+			code.push_back(0x87);
+			EmitModRM(0b11, bval & 0x07, aval & 0x07, code);
+		}
+		
 		void WriteJump(const size_t from, const size_t to, MachineCode &code) {
 			int32_t diff = static_cast<int32_t>(to) - (static_cast<int32_t>(from) + 5);
 			code[from] = 0xE9;
@@ -424,6 +843,17 @@ namespace Compiler {
 			memcpy(&code[from + 2], &diff, 4);
 		}
 		
+		/* NOTE Takes the opcode of the short (rel8) form of a conditional jump, as
+		 * found in the Comparison enum, for conditions that have no Comparison.
+		 */
+		void WriteJump(const size_t from, const size_t to, const uint8_t opcode, MachineCode &code) {
+			int32_t diff = static_cast<int32_t>(to) - (static_cast<int32_t>(from) + 6);
+			
+			code[from] = 0x0F;
+			code[from + 1] = 0x10 + opcode;
+			memcpy(&code[from + 2], &diff, 4);
+		}
+		
 		void EmitReturn(MachineCode &code) {
 			code.push_back(0xC3);
 		}
@@ -442,10 +872,42 @@ namespace Compiler {
 			code.push_back(0x58 | (regval & 0x07));
 		}
 		
+		void EmitXchgRsp(const Register reg, MachineCode &code) {
+			const auto regval = static_cast<uint8_t>(reg);
+			
+			EmitRexW(regval & 0x08, false, code);
+			code.push_back(0x87);
+			EmitModRM(0b11, regval & 0x07, 0b100, code);
+		}
+		
+		void EmitPopRsp(MachineCode &code) {
+			code.push_back(0x5C);
+		}
+		
 		void EmitNop(const size_t length, MachineCode &code) {
 			for (size_t i = 0; i < length; ++i) code.push_back(0x90);
 		}
 		
+		// The recommended multi-byte NOPs, so padding that runs takes as few instructions as possible
+		void EmitPadding(size_t length, MachineCode &code) {
+			static const unsigned char NOPS[9][9] = {
+					{0x90},
+					{0x66, 0x90},
+					{0x0F, 0x1F, 0x00},
+					{0x0F, 0x1F, 0x40, 0x00},
+					{0x0F, 0x1F, 0x44, 0x00, 0x00},
+					{0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+					{0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+					{0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+					{0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+			};
+			while (length > 0) {
+				const size_t part = std::min<size_t>(length, 9);
+				code.append(NOPS[part - 1], part);
+				length -= part;
+			}
+		}
+		
 		void EmitCall(const Register reg, MachineCode &code) {
 			const auto regval = static_cast<uint8_t>(reg);
 			
@@ -454,34 +916,168 @@ namespace Compiler {
 			EmitModRM(0b11, 2, regval & 0x07, code);
 		}
 		
+		/* NOTE Calls a function following the System V ABI with the stack aligned to
+		 * 16 bytes. Clobbers rax and every caller-saved register.
+		 */
+		void EmitAlignedCall(const int64_t addr, MachineCode &code) {
+			// push rbp; mov rbp, rsp; and rsp, -16
+			EmitPush(Register::rbp, code);
+			EmitRexW(false, false, code);
+			code.push_back(0x89);
+			EmitModRM(0b11, 0b100, 0b101, code);
+			EmitRexW(false, false, code);
+			code.push_back(0x83);
+			EmitModRM(0b11, 4, 0b100, code);
+			EmitImm8(-16, code);
+			
+			EmitMov(Register::rax, addr, code);
+			EmitCall(Register::rax, code);
+			
+			// mov rsp, rbp; pop rbp
+			EmitRexW(false, false, code);
+			code.push_back(0x89);
+			EmitModRM(0b11, 0b101, 0b100, code);
+			EmitPop(Register::rbp, code);
+		}
+		
 		void WriteCall(const size_t from, const size_t to, MachineCode &code) {
 			int32_t diff = static_cast<int32_t>(to) - (static_cast<int32_t>(from) + 5);
 			
 			code[from] = 0xE8;
 			memcpy(&code[from + 1], &diff, 4);
 		}
+		
+		void WriteRipOffset(const size_t from, const size_t to, MachineCode &code) {
+			int32_t diff = static_cast<int32_t>(to) - (static_cast<int32_t>(from) + 4);
+			
+			memcpy(&code[from], &diff, 4);
+		}
 	}
 	
-	[[nodiscard]]  Error CompileProcedure(const Statements &statements, MachineCode &code, std::unordered_map<size_t, std::string> &callTable);
+	[[nodiscard]]  Error CompileProcedure(const IR::Procedure &procedure, MachineCode &code, std::unordered_map<size_t, std::string> &callTable, const LiveRegisters &liveAfter,
+	                                      std::vector<size_t> &loopHeads);
 	
-	[[nodiscard]]  Error CompileStatement(const Parser::Statement &statement, MachineCode &code, std::unordered_map<size_t, std::string> &callTable);
+	[[nodiscard]]  Error CompileInstruction(const IR::Instruction &instruction, MachineCode &code, std::unordered_map<size_t, std::string> &callTable, const LiveRegisters &liveAfter);
 	
-	[[nodiscard]]  Error CompileCondition(const Condition &condition, MachineCode &code, bool &inverted);
+	[[nodiscard]]  Error CompileStatement(const Parser::Statement &statement, MachineCode &code, std::unordered_map<size_t, std::string> &callTable, const LiveRegisters &liveAfter);
 	
-	void CompileStartProcedure(MachineCode &code, std::unordered_map<size_t, std::string> &callTable);
+	[[nodiscard]]  Error CompileCondition(const IR::Condition &condition, MachineCode &code);
 	
+	[[nodiscard]] Error CompileBinary(Register dest, Operation op, const IR::Value &sourceA, const IR::Value &sourceB, bool narrow, CodePos pos, RegisterSet live,
+	                                  MachineCode &code);
 	
-	[[nodiscard]] Error Compile(std::unordered_map<std::string, Statements> &procedures, MachineCode &code, size_t &entry) {
-		std::unordered_map<std::string, size_t> procedureMap;
-		std::unordered_map<size_t, std::string> callTable;
-		
-		for (const auto &[name, statements]: procedures) {
-			const size_t ptr = code.length();
-			procedureMap[name] = ptr;
-			
-			Error _error = (CompileProcedure(statements, code, callTable));
-			if (_error)return _error;
-		}
+	void CompileDivision(std::optional<Register> quotient, std::optional<Register> remainder, const IR::Value &dividend, const IR::Value &divisor, bool narrow,
+	                     RegisterSet live, MachineCode &code);
+	
+	void CompileIdiv(std::optional<Register> quotient, std::optional<Register> remainder, const IR::Value &dividend, const IR::Value &divisor, bool narrow,
+	                 RegisterSet live, MachineCode &code);
+	
+	void CompileConstantDivision(std::optional<Register> quotient, std::optional<Register> remainder, Register dividend, int64_t divisor, bool narrow,
+	                             RegisterSet live, MachineCode &code);
+	
+	void CompileText(const std::string &text, RegisterSet live, MachineCode &code);
+	
+	void CompileBufferedText(size_t textPtr, size_t length, RegisterSet live, MachineCode &code);
+	
+	void CompileInlinePrint(Register source, RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileBytes(const Parser::StdoutBytesStatement &statement, RegisterSet live, MachineCode &code);
+	
+	void CompileMapFile(const Parser::MapFileStatement &statement, RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileAlloc(const Parser::AllocStatement &statement, RegisterSet live, MachineCode &code);
+	
+	void CompileReset(RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileCopy(const Parser::CopyStatement &statement, RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileFill(const Parser::FillStatement &statement, RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileCompare(const Parser::CompareStatement &statement, RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileFind(const Parser::FindStatement &statement, RegisterSet live, MachineCode &code);
+	
+	[[nodiscard]] Error CompileTableCall(const Parser::TableStatement &statement, RegisterSet live, MachineCode &code);
+	
+	void CompileTimestamp(Register dest, std::optional<Register> processor, RegisterSet live, MachineCode &code);
+	
+	void CompileStartProcedure(MachineCode &code, std::unordered_map<size_t, std::string> &callTable);
+	
+	void CompileRuntimeStubs(MachineCode &code);
+	
+	void CompileFreestandingFlush(MachineCode &code);
+	
+	void CompileFreestandingWrite(MachineCode &code);
+	
+	void CompileWriteLoop(MachineCode &code);
+	
+	void CompileFreestandingMapFile(MachineCode &code);
+	
+	void CompileOutputDescriptor(Register dest, MachineCode &code);
+	
+	void CompileArenaDescriptor(Register dest, MachineCode &code);
+	
+	void CompileFreestandingGrowArena(MachineCode &code);
+	
+	static size_t flushStubPtr;
+	static size_t writeStubPtr;
+	static size_t mapFileStubPtr;
+	static size_t growArenaStubPtr;
+	
+	
+	// Registers a System V function is free to overwrite.
+	constexpr RegisterSet CALLER_SAVED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rdx)
+	                                     | RegisterBit(Register::rsi) | RegisterBit(Register::rdi) | RegisterBit(Register::r8)
+	                                     | RegisterBit(Register::r9) | RegisterBit(Register::r10) | RegisterBit(Register::r11);
+	
+	// Registers used by the copy, fill, compare and find statements, besides xmm0 and xmm1.
+	constexpr RegisterSet BLOCK_USED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rdx) | RegisterBit(Register::rsi)
+	                                   | RegisterBit(Register::rdi);
+	
+	// Sizes from which memory statements switch to 16-byte vectors and to rep movsb/stosb.
+	constexpr int64_t BLOCK_VECTOR_MIN = 16;
+	constexpr int64_t BLOCK_REP_MIN = 2048;
+	
+	enum class BlockSize {
+		Bytes,  // Below 8 bytes, or below BLOCK_VECTOR_MIN without word moves
+		Words,  // Two overlapping 8-byte moves
+		Vector, // 16-byte loop and an overlapping last vector
+		Rep,    // Microcoded string instruction
+	};
+	
+	
+	[[nodiscard]] Error Compile(std::unordered_map<std::string, Statements> &procedures, const std::unordered_map<std::string, IR::Procedure> &ir, MachineCode &code, size_t &entry, size_t &rodataPtr, size_t &dataPtr, std::vector<PeepholeStats> &peephole) {
+		std::unordered_map<std::string, size_t> procedureMap;
+		std::unordered_map<size_t, std::string> callTable;
+		std::vector<size_t> loopHeads;
+		LiveRegisters liveAfter;
+		
+		rodata.clear();
+		writable.clear();
+		stringPool.clear();
+		constantPool.clear();
+		sectionRefs.clear();
+		peephole.clear();
+		
+		static_assert(OUTPUT_DESCRIPTOR_PTR + sizeof(OutputBuffer) <= ARENA_DESCRIPTOR_PTR);
+		if (Options::flag_freestanding) writable.append(ARENA_DESCRIPTOR_PTR + sizeof(Arena), 0);
+		
+		AnalyzeLiveness(procedures, liveAfter);
+		CompileRuntimeStubs(code);
+		
+		for (const auto &[name, procedure]: ir) {
+			const size_t ptr = code.length();
+			procedureMap[name] = ptr;
+			
+			loopHeads.clear();
+			Error _error = (CompileProcedure(procedure, code, callTable, liveAfter, loopHeads));
+			if (_error)return _error;
+			
+			if (Options::optimizationLevel >= 1) {
+				peephole.push_back(PeepholeStats{name, 0, 0, 0, 0, 0, true});
+				OptimizeProcedure(code, ptr, callTable, sectionRefs, loopHeads, peephole.back());
+			}
+		}
 		
 		entry = code.length();
 		CompileStartProcedure(code, callTable);
@@ -497,275 +1093,130 @@ namespace Compiler {
 			}
 		}
 		
-		return Error::None;
-	}
-	
-	[[nodiscard]]  Error CompileProcedure(const Statements &statements, MachineCode &code, std::unordered_map<size_t, std::string> &callTable) {
-		for (const auto &statement: statements) {
-			Error _error = (CompileStatement(*statement, code, callTable));
-			if (_error)return _error;
+		// Each section starts on its own page so it can be mapped with its own permissions.
+		rodataPtr = (code.length() + MODULE_PAGE_SIZE - 1) & ~(MODULE_PAGE_SIZE - 1);
+		code.append(rodataPtr - code.length(), 0xCC);
+		code.append(rodata);
+		
+		dataPtr = code.length();
+		if (!writable.empty()) {
+			dataPtr = (code.length() + MODULE_PAGE_SIZE - 1) & ~(MODULE_PAGE_SIZE - 1);
+			code.append(dataPtr - code.length(), 0);
+			code.append(writable);
 		}
 		
-		if (!loopBreaks.empty() || !loopContinues.empty()) {
-			return Error{"Break or continue statements in a procedure outside a loop.", CodePos{0, 0}};
+		for (const auto &ref: sectionRefs) {
+			Gen::WriteRipOffset(ref.from, (ref.section == Section::ReadOnly ? rodataPtr : dataPtr) + ref.offset, code);
 		}
 		
-		Gen::EmitReturn(code);
 		return Error::None;
 	}
 	
-	[[nodiscard]]  Error CompileStatement(const Parser::Statement &statement, MachineCode &code, std::unordered_map<size_t, std::string> &callTable) {
-		const size_t startPtr = code.length();
+	size_t AddString(const std::string &text) {
+		const auto [it, inserted] = stringPool.try_emplace(text, rodata.length());
+		if (inserted) rodata.append(reinterpret_cast<const unsigned char *>(text.data()), text.length());
+		return it->second;
+	}
+	
+	size_t AddConstant(const int64_t value) {
+		auto it = constantPool.find(value);
+		if (it != constantPool.end()) return it->second;
 		
-		bool conditionalJumpInverted = true;
-		size_t conditionalJumpPtr = 0;
-		if (statement.condition.has_value()) {
-			Error _error = (CompileCondition(*statement.condition, code, conditionalJumpInverted));
-			if (_error)return _error;
-			conditionalJumpPtr = code.length();
-			Gen::EmitNop(6, code);
-		}
+		rodata.append((8 - rodata.length() % 8) % 8, 0);
+		const size_t ptr = rodata.length();
+		Gen::EmitImm64(value, rodata);
+		constantPool[value] = ptr;
+		return ptr;
+	}
+	
+	/* NOTE Blocks are emitted in layout order. A jump to the next block is left
+	 * out, and a branch to the next block jumps to the other successor on the
+	 * opposite condition instead. Jumps are patched once every block has been
+	 * placed. Loop heads are padded to LOOP_ALIGNMENT and their positions
+	 * added to loopHeads, so the peephole pass can keep them aligned.
+	 */
+	[[nodiscard]]  Error CompileProcedure(const IR::Procedure &procedure, MachineCode &code, std::unordered_map<size_t, std::string> &callTable, const LiveRegisters &liveAfter,
+	                                      std::vector<size_t> &loopHeads) {
+		struct BlockJump {
+			size_t from;
+			size_t block;
+			bool conditional;
+			Comparison comp;
+			bool inverted;
+		};
 		
-		switch (statement.tag) {
-			case StatementTag::Assignment: {
-				const auto &stmt = dynamic_cast<const Parser::AssignmentStatement &>(statement);
-				switch (stmt.source->tag) {
-					case OperandTag::Register: Gen::EmitMov(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-						break;
-					case OperandTag::Immediate: Gen::EmitMov(stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-						break;
-					default: return Error{"Unsopported source argument type.", statement.pos};
-				}
-				break;
-			}
-			case StatementTag::Shorthand: {
-				const auto &stmt = dynamic_cast<const Parser::ShorthandStatement &>(statement);
-				switch (stmt.op) {
-					case Operation::Add:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: Gen::EmitAdd(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								break;
-							case OperandTag::Immediate: Gen::EmitAdd(stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								break;
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::Sub:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: Gen::EmitSub(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								break;
-							case OperandTag::Immediate: Gen::EmitSub(stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								break;
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::Mul:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: Gen::EmitImul(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								break;
-							case OperandTag::Immediate: Gen::EmitImul(stmt.dest, stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								break;
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::Div:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: {
-								Gen::EmitMovStack(-1, Register::rax, code);
-								Gen::EmitMovStack(-2, Register::rdx, code);
-								Gen::EmitMovStack(-3, Register::rbx, code);
-								
-								Gen::EmitMovStack(-4, stmt.dest, code);
-								Gen::EmitMovStack(-5, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								
-								Gen::EmitMov(Register::rdx, 0, code);
-								Gen::EmitMovStack(Register::rax, -4, code);
-								Gen::EmitMovStack(Register::rbx, -5, code);
-								
-								Gen::EmitIdiv(Register::rbx, code);
-								Gen::EmitMovStack(-4, Register::rax, code);
-								
-								Gen::EmitMovStack(Register::rax, -1, code);
-								Gen::EmitMovStack(Register::rdx, -2, code);
-								Gen::EmitMovStack(Register::rbx, -3, code);
-								
-								Gen::EmitMovStack(stmt.dest, -4, code);
-								break;
-							}
-							case OperandTag::Immediate: {
-								Gen::EmitMovStack(-1, Register::rax, code);
-								Gen::EmitMovStack(-2, Register::rdx, code);
-								Gen::EmitMovStack(-3, Register::rbx, code);
-								
-								Gen::EmitMovStack(-4, stmt.dest, code);
-								
-								Gen::EmitMov(Register::rdx, 0, code);
-								Gen::EmitMovStack(Register::rax, -4, code);
-								Gen::EmitMovStack(Register::rbx, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								
-								Gen::EmitIdiv(Register::rbx, code);
-								Gen::EmitMovStack(-4, Register::rax, code);
-								
-								Gen::EmitMovStack(Register::rax, -1, code);
-								Gen::EmitMovStack(Register::rdx, -2, code);
-								Gen::EmitMovStack(Register::rbx, -3, code);
-								
-								Gen::EmitMovStack(stmt.dest, -4, code);
-								break;
-							}
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::Mod:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: {
-								Gen::EmitMovStack(-1, Register::rax, code);
-								Gen::EmitMovStack(-2, Register::rdx, code);
-								Gen::EmitMovStack(-3, Register::rbx, code);
-								
-								Gen::EmitMovStack(-4, stmt.dest, code);
-								Gen::EmitMovStack(-5, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								
-								Gen::EmitMov(Register::rdx, 0, code);
-								Gen::EmitMovStack(Register::rax, -4, code);
-								Gen::EmitMovStack(Register::rbx, -5, code);
-								
-								Gen::EmitIdiv(Register::rbx, code);
-								Gen::EmitMovStack(-4, Register::rdx, code);
-								
-								Gen::EmitMovStack(Register::rax, -1, code);
-								Gen::EmitMovStack(Register::rdx, -2, code);
-								Gen::EmitMovStack(Register::rbx, -3, code);
-								
-								Gen::EmitMovStack(stmt.dest, -4, code);
-								break;
-							}
-							case OperandTag::Immediate: {
-								Gen::EmitMovStack(-1, Register::rax, code);
-								Gen::EmitMovStack(-2, Register::rdx, code);
-								Gen::EmitMovStack(-3, Register::rbx, code);
-								
-								Gen::EmitMovStack(-4, stmt.dest, code);
-								
-								Gen::EmitMov(Register::rdx, 0, code);
-								Gen::EmitMovStack(Register::rax, -4, code);
-								Gen::EmitMovStack(Register::rbx, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								
-								Gen::EmitIdiv(Register::rbx, code);
-								Gen::EmitMovStack(-4, Register::rdx, code);
-								
-								Gen::EmitMovStack(Register::rax, -1, code);
-								Gen::EmitMovStack(Register::rdx, -2, code);
-								Gen::EmitMovStack(Register::rbx, -3, code);
-								
-								Gen::EmitMovStack(stmt.dest, -4, code);
-								break;
-							}
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::And:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: Gen::EmitAnd(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								break;
-							case OperandTag::Immediate: Gen::EmitAnd(stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								break;
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::Or:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: Gen::EmitOr(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								break;
-							case OperandTag::Immediate: Gen::EmitOr(stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								break;
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					case Operation::Xor:
-						switch (stmt.source->tag) {
-							case OperandTag::Register: Gen::EmitXor(stmt.dest, dynamic_cast<const RegisterOperand &>(*stmt.source).reg, code);
-								break;
-							case OperandTag::Immediate: Gen::EmitXor(stmt.dest, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
-								break;
-							default: return Error{"Unsopported source argument type.", statement.pos};
-						}
-						break;
-					default: return Error{"Unsupported shorthand operation type.", stmt.pos};
-				}
-				break;
-			}
-			case StatementTag::Longhand: {
-				//const auto& stmt = static_cast<const LonghandStatement&>(statement);
-				return Error{"Statement not implemented in the compiler.", statement.pos};
+		std::vector<size_t> blockPtrs(procedure.blocks.size());
+		std::vector<BlockJump> jumps;
+		
+		for (size_t i = 0; i < procedure.blocks.size(); ++i) {
+			const IR::Block &block = procedure.blocks[i];
+			if (block.loopHead) {
+				Gen::EmitPadding((LOOP_ALIGNMENT - code.length() % LOOP_ALIGNMENT) % LOOP_ALIGNMENT, code);
+				loopHeads.push_back(code.length());
 			}
-			case StatementTag::Loop: {
-				const auto &stmt = dynamic_cast<const Parser::LoopStatement &>(statement);
-				
-				for (const auto &innerStatement: stmt.statements) {
-					Error _error = (CompileStatement(*innerStatement, code, callTable));
-					if (_error)
-						return _error;
-				}
-				
-				const size_t jumpBackPtr = code.length();
-				Gen::EmitNop(5, code);
-				Gen::WriteJump(jumpBackPtr, startPtr, code);
-				
-				for (const auto ptr: loopBreaks) {
-					Gen::WriteJump(ptr, code.length(), code);
-				}
-				
-				for (const auto ptr: loopContinues) {
-					Gen::WriteJump(ptr, startPtr, code);
-				}
-				
-				loopBreaks.clear();
-				loopContinues.clear();
-				break;
+			blockPtrs[i] = code.length();
+			
+			for (const auto &instruction: block.instructions) {
+				Error _error = (CompileInstruction(instruction, code, callTable, liveAfter));
+				if (_error)return _error;
 			}
-			case StatementTag::Branch: {
-				const auto &stmt = dynamic_cast<const Parser::BranchStatement &>(statement);
-				
-				size_t jumpPastElsePtr = 0;
-				for (const auto &innerStatement: stmt.statements) {
-					Error _error = (CompileStatement(*innerStatement, code, callTable));
+			
+			const IR::Terminator &terminator = block.terminator;
+			switch (terminator.tag) {
+				case IR::TerminatorTag::Jump:
+					if (terminator.target != i + 1) {
+						jumps.push_back(BlockJump{code.length(), terminator.target, false, Comparison::Equals, false});
+						Gen::EmitNop(5, code);
+					}
+					break;
+				case IR::TerminatorTag::Branch: {
+					Error _error = (CompileCondition(terminator.condition, code));
 					if (_error)return _error;
 					
-					if (!stmt.elseBlock.empty()) {
-						jumpPastElsePtr = code.length();
+					const bool inverted = terminator.target == i + 1;
+					jumps.push_back(BlockJump{code.length(), inverted ? terminator.otherwise : terminator.target, true, terminator.condition.comp, inverted});
+					Gen::EmitNop(6, code);
+					
+					if (!inverted && terminator.otherwise != i + 1) {
+						jumps.push_back(BlockJump{code.length(), terminator.otherwise, false, Comparison::Equals, false});
 						Gen::EmitNop(5, code);
 					}
+					break;
 				}
-				const size_t ifBlockEndPtr = code.length();
-				if (!stmt.elseBlock.empty()) {
-					for (const auto &innerStatement: stmt.elseBlock) {
-						Error _error = (CompileStatement(*innerStatement, code, callTable));
-						if (_error)return _error;
-						
-					}
-					const size_t elseBlockEndPtr = code.length();
-					
-					Gen::WriteJump(jumpPastElsePtr, elseBlockEndPtr, code);
-				}
-				
-				Gen::WriteJump(conditionalJumpPtr, ifBlockEndPtr, statement.condition->comp, conditionalJumpInverted, code);
-				break;
-			}
-			case StatementTag::Break: {
-				loopBreaks.emplace(code.length());
-				Gen::EmitNop(5, code);
-				break;
-			}
-			case StatementTag::Continue: {
-				loopContinues.emplace(code.length());
-				Gen::EmitNop(5, code);
-				break;
-			}
-			case StatementTag::Return: {
-				Gen::EmitReturn(code);
-				break;
+				case IR::TerminatorTag::Return: Gen::EmitReturn(code);
+					break;
 			}
+		}
+		
+		for (const auto &jump: jumps) {
+			if (jump.conditional) Gen::WriteJump(jump.from, blockPtrs[jump.block], jump.comp, jump.inverted, code);
+			else Gen::WriteJump(jump.from, blockPtrs[jump.block], code);
+		}
+		return Error::None;
+	}
+	
+	[[nodiscard]]  Error CompileInstruction(const IR::Instruction &instruction, MachineCode &code, std::unordered_map<size_t, std::string> &callTable, const LiveRegisters &liveAfter) {
+		switch (instruction.tag) {
+			case IR::InstructionTag::Move:
+				if (instruction.a.tag == OperandTag::Register) Gen::EmitMov(instruction.dest, instruction.a.reg, code);
+				else Gen::EmitMov(instruction.dest, instruction.a.value, code);
+				return Error::None;
+			case IR::InstructionTag::Binary:
+				return CompileBinary(instruction.dest, instruction.op, instruction.a, instruction.b, instruction.narrow, instruction.statement->pos,
+				                     liveAfter.at(instruction.statement), code);
+			case IR::InstructionTag::DivMod:
+				CompileDivision(instruction.dest, instruction.remainder, instruction.a, instruction.b, instruction.narrow, liveAfter.at(instruction.statement), code);
+				return Error::None;
+			case IR::InstructionTag::Statement: return CompileStatement(*instruction.statement, code, callTable, liveAfter);
+		}
+		return Error::None;
+	}
+	
+	/* NOTE Compiles the statements the IR carries as they are. Conditions and
+	 * control flow have been lowered to blocks by then.
+	 */
+	[[nodiscard]]  Error CompileStatement(const Parser::Statement &statement, MachineCode &code, std::unordered_map<size_t, std::string> &callTable, const LiveRegisters &liveAfter) {
+		switch (statement.tag) {
 			case StatementTag::Call: {
 				const auto &stmt = dynamic_cast<const Parser::CallStatement &>(statement);
 				
@@ -775,56 +1226,130 @@ namespace Compiler {
 			}
 			case StatementTag::Stdout: {
 				const auto &stmt = dynamic_cast<const Parser::StdoutStatement &>(statement);
+				const RegisterSet live = liveAfter.at(&statement);
+				
+				if (Options::outputBufferSize != 0 && Options::flag_inlinePrint) {
+					switch (stmt.source->tag) {
+						case OperandTag::Register: CompileInlinePrint(dynamic_cast<const RegisterOperand &>(*stmt.source).reg, live, code);
+							break;
+						case OperandTag::Immediate: {
+							unsigned char text[MAX_DECIMAL_LENGTH];
+							const unsigned char *textEnd = WriteDecimal(dynamic_cast<const ImmediateOperand &>(*stmt.source).value, text);
+							CompileText(std::string(reinterpret_cast<const char *>(text), textEnd - text), live, code);
+							break;
+						}
+						default: return Error{"Unsopported source argument type.", statement.pos};
+					}
+					break;
+				}
 				
 				void (*fn)(int64_t) = &Print;
 				int64_t addr;
 				memcpy(&addr, &fn, 8);
 				
-				Gen::EmitPushAllRegs(code);
+				const RegisterSet saved = CALLER_SAVED & live;
+				Gen::EmitPushRegs(saved, code);
 				
 				switch (stmt.source->tag) {
 					case OperandTag::Register: {
 						const auto &source = dynamic_cast<const RegisterOperand &>(*stmt.source);
-						const Register callReg = source.reg != Register::rax ? Register::rax : Register::rbx;
-						Gen::EmitMov(callReg, addr, code);
 						if (source.reg != Register::rdi) Gen::EmitMov(Register::rdi, source.reg, code);
-						Gen::EmitCall(callReg, code);
 						break;
 					}
-					case OperandTag::Immediate: {
-						const int64_t value = dynamic_cast<const ImmediateOperand &>(*stmt.source).value;
-						Gen::EmitMov(Register::rax, addr, code);
-						Gen::EmitMov(Register::rdi, value, code);
-						Gen::EmitCall(Register::rax, code);
+					case OperandTag::Immediate: Gen::EmitMov(Register::rdi, dynamic_cast<const ImmediateOperand &>(*stmt.source).value, code);
 						break;
-					}
 					default: return Error{"Unsopported source argument type.", statement.pos};
 				}
+				Gen::EmitAlignedCall(addr, code);
 				
-				Gen::EmitPopAllRegs(code);
+				Gen::EmitPopRegs(saved, code);
 				
 				break;
 			}
 			case StatementTag::StdoutText: {
-				const auto &stmt = dynamic_cast<const Parser::StdoutTextStatement &>(statement);
+				CompileText(dynamic_cast<const Parser::StdoutTextStatement &>(statement).text, liveAfter.at(&statement), code);
+				break;
+			}
+			case StatementTag::StdoutBytes: {
+				Error _error = (CompileBytes(dynamic_cast<const Parser::StdoutBytesStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
+				break;
+			}
+			case StatementTag::Stdin: {
+				const Register dest = dynamic_cast<const Parser::RegisterStatement &>(statement).reg;
+				if (Options::flag_freestanding) return Error{"Reading input is not supported in freestanding mode.", statement.pos};
 				
-				void (*fn)(const char *, size_t) = &Print;
+				int64_t (*fn)(int64_t) = &ReadInteger;
 				int64_t addr;
 				memcpy(&addr, &fn, 8);
 				
-				Gen::EmitNop(5, code);
-				const size_t textPtr = code.length();
-				code.append(reinterpret_cast<const unsigned char *>(stmt.text.data()), stmt.text.length());
-				Gen::WriteJump(startPtr, code.length(), code);
+				// The destination is overwritten anyway, don't restore it over the result.
+				const RegisterSet saved = CALLER_SAVED & liveAfter.at(&statement) & ~RegisterBit(dest);
+				Gen::EmitPushRegs(saved, code);
+				
+				if (dest != Register::rdi) Gen::EmitMov(Register::rdi, dest, code);
+				Gen::EmitAlignedCall(addr, code);
+				if (dest != Register::rax) Gen::EmitMov(dest, Register::rax, code);
 				
-				Gen::EmitPushAllRegs(code);
+				Gen::EmitPopRegs(saved, code);
+				break;
+			}
+			case StatementTag::MapFile: CompileMapFile(dynamic_cast<const Parser::MapFileStatement &>(statement), liveAfter.at(&statement), code);
+				break;
+			case StatementTag::Alloc: {
+				Error _error = (CompileAlloc(dynamic_cast<const Parser::AllocStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
+				break;
+			}
+			case StatementTag::Reset: CompileReset(liveAfter.at(&statement), code);
+				break;
+			case StatementTag::Table: {
+				const Register dest = dynamic_cast<const Parser::RegisterStatement &>(statement).reg;
+				if (Options::flag_freestanding) return Error{"Hash tables are not supported in freestanding mode.", statement.pos};
 				
-				Gen::EmitMov(Register::rax, addr, code);
-				Gen::EmitLea(Register::rdi, textPtr, code);
-				Gen::EmitMov(Register::rsi, (int64_t) stmt.text.length(), code);
-				Gen::EmitCall(Register::rax, code);
+				HashTable *(*fn)() = &NewTable;
+				int64_t addr;
+				memcpy(&addr, &fn, 8);
 				
-				Gen::EmitPopAllRegs(code);
+				const RegisterSet saved = CALLER_SAVED & liveAfter.at(&statement) & ~RegisterBit(dest);
+				Gen::EmitPushRegs(saved, code);
+				Gen::EmitAlignedCall(addr, code);
+				if (dest != Register::rax) Gen::EmitMov(dest, Register::rax, code);
+				Gen::EmitPopRegs(saved, code);
+				break;
+			}
+			case StatementTag::Insert:
+			case StatementTag::Lookup:
+			case StatementTag::Increment: {
+				Error _error = (CompileTableCall(dynamic_cast<const Parser::TableStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
+				break;
+			}
+			case StatementTag::Rdtsc: CompileTimestamp(dynamic_cast<const Parser::RegisterStatement &>(statement).reg, std::nullopt, liveAfter.at(&statement), code);
+				break;
+			case StatementTag::Rdtscp: {
+				const auto &stmt = dynamic_cast<const Parser::RegisterPairStatement &>(statement);
+				CompileTimestamp(stmt.first, stmt.second, liveAfter.at(&statement), code);
+				break;
+			}
+			case StatementTag::Copy: {
+				Error _error = (CompileCopy(dynamic_cast<const Parser::CopyStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
+				break;
+			}
+			case StatementTag::Fill: {
+				Error _error = (CompileFill(dynamic_cast<const Parser::FillStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
+				break;
+			}
+			case StatementTag::Compare: {
+				Error _error = (CompileCompare(dynamic_cast<const Parser::CompareStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
+				break;
+			}
+			case StatementTag::Find: {
+				Error _error = (CompileFind(dynamic_cast<const Parser::FindStatement &>(statement), liveAfter.at(&statement), code));
+				if (_error)return _error;
 				break;
 			}
 			case StatementTag::Push: Gen::EmitPush(dynamic_cast<const Parser::RegisterStatement &>(statement).reg, code);
@@ -833,37 +1358,16 @@ namespace Compiler {
 				break;
 			default: return Error{"Statement not implemented in the compiler.", statement.pos};
 		}
-		
-		if (statement.condition.has_value() && statement.tag != StatementTag::Branch) {
-			Gen::WriteJump(conditionalJumpPtr, code.length(), statement.condition->comp, conditionalJumpInverted, code);
-		}
 		return Error::None;
 	}
 	
-	[[nodiscard]]  Error CompileCondition(const Condition &condition, MachineCode &code, bool &inverted) {
-		const OperandTag atag = condition.a->tag;
-		const OperandTag btag = condition.b->tag;
-		
-		if (atag == OperandTag::Register && btag == OperandTag::Register) {
-			Gen::EmitCmp(
-					dynamic_cast<const RegisterOperand &>(*condition.a).reg,
-					dynamic_cast<const RegisterOperand &>(*condition.b).reg,
-					code, inverted
-			);
+	[[nodiscard]]  Error CompileCondition(const IR::Condition &condition, MachineCode &code) {
+		bool inverted = false;
+		if (condition.a.tag == OperandTag::Register && condition.b.tag == OperandTag::Register) {
+			Gen::EmitCmp(condition.a.reg, condition.b.reg, code, inverted);
 		}
-		else if (atag == OperandTag::Register && btag == OperandTag::Immediate) {
-			Gen::EmitCmp(
-					dynamic_cast<const RegisterOperand &>(*condition.a).reg,
-					dynamic_cast<const ImmediateOperand &>(*condition.b).value,
-					code, inverted
-			);
-		}
-		else if (atag == OperandTag::Immediate && btag == OperandTag::Register) {
-			Gen::EmitCmp(
-					dynamic_cast<const ImmediateOperand &>(*condition.a).value,
-					dynamic_cast<const RegisterOperand &>(*condition.b).reg,
-					code, inverted
-			);
+		else if (condition.a.tag == OperandTag::Register && condition.b.tag == OperandTag::Immediate) {
+			Gen::EmitCmp(condition.a.reg, condition.b.value, code, inverted);
 		}
 		else {
 			return Error{"Unsupported comparison operand type combination", condition.pos};
@@ -872,15 +1376,1687 @@ namespace Compiler {
 		return Error::None;
 	}
 	
+	/* NOTE Called by the runtime with the top of the stack the program runs on
+	 * in rdi. The host stack pointer is kept on the new stack.
+	 */
 	void CompileStartProcedure(MachineCode &code, std::unordered_map<size_t, std::string> &callTable) {
 		Gen::EmitPushAllRegs(code);
+		Gen::EmitXchgRsp(Register::rdi, code);
+		Gen::EmitPush(Register::rdi, code);
 		
 		const size_t ptr = code.length();
 		Gen::EmitNop(5, code);
 		callTable[ptr] = "main";
 		
+		// Nothing flushes the module's own buffer after it returns.
+		if (Options::flag_freestanding) {
+			const size_t flushCallPtr = code.length();
+			Gen::EmitNop(5, code);
+			Gen::WriteCall(flushCallPtr, flushStubPtr, code);
+		}
+		
+		Gen::EmitPopRsp(code);
 		Gen::EmitPopAllRegs(code);
 		
 		Gen::EmitReturn(code);
 	}
-}
\ No newline at end of file
+	
+	/* NOTE Lowers dest = a op b, which shorthand statements reach with dest as
+	 * a, without a separate mov where the instruction set allows it: lea for
+	 * additions and multiplications by 3, 5 and 9, three-operand imul, and
+	 * operating on dest in place when it is one of the sources. Two immediates
+	 * are folded.
+	 */
+	[[nodiscard]] Error CompileBinary(const Register dest, const Operation op, const IR::Value &sourceA, const IR::Value &sourceB, const bool narrow, const CodePos pos,
+	                                  const RegisterSet live, MachineCode &code) {
+		if (op == Operation::Div || op == Operation::Mod) {
+			if (op == Operation::Div) CompileDivision(dest, std::nullopt, sourceA, sourceB, narrow, live, code);
+			else CompileDivision(std::nullopt, dest, sourceA, sourceB, narrow, live, code);
+			return Error::None;
+		}
+		
+		const auto fitsInt32 = [](const int64_t value) {
+			return value >= INT32_MIN && value <= INT32_MAX;
+		};
+		
+		if (sourceA.tag == OperandTag::Immediate && sourceB.tag == OperandTag::Immediate) {
+			const auto a = static_cast<uint64_t>(sourceA.value);
+			const auto b = static_cast<uint64_t>(sourceB.value);
+			uint64_t result;
+			switch (op) {
+				case Operation::Add: result = a + b;
+					break;
+				case Operation::Sub: result = a - b;
+					break;
+				case Operation::Mul: result = a * b;
+					break;
+				case Operation::And: result = a & b;
+					break;
+				case Operation::Or: result = a | b;
+					break;
+				case Operation::Xor: result = a ^ b;
+					break;
+				default: return Error{"Unsupported arithmetic operation type.", pos};
+			}
+			Gen::EmitMov(dest, static_cast<int64_t>(result), code);
+			return Error::None;
+		}
+		
+		// Subtraction from an immediate, the only case with the immediate first that isn't swapped.
+		if (op == Operation::Sub && sourceA.tag == OperandTag::Immediate) {
+			const Register b = sourceB.reg;
+			const int64_t a = sourceA.value;
+			if (dest == b) {
+				Gen::EmitNeg(dest, code);
+				Gen::EmitAdd(dest, a, code);
+			}
+			else {
+				Gen::EmitMov(dest, a, code);
+				Gen::EmitSub(dest, b, code);
+			}
+			return Error::None;
+		}
+		
+		const bool swap = sourceA.tag == OperandTag::Immediate;
+		const Register a = swap ? sourceB.reg : sourceA.reg;
+		const IR::Value &second = swap ? sourceA : sourceB;
+		
+		if (second.tag == OperandTag::Immediate) {
+			const int64_t b = second.value;
+			switch (op) {
+				case Operation::Add:
+					if (dest != a && fitsInt32(b)) {
+						Gen::EmitLea(dest, a, static_cast<int32_t>(b), code);
+						return Error::None;
+					}
+					break;
+				case Operation::Sub:
+					if (dest != a && b != INT32_MIN && fitsInt32(b)) {
+						Gen::EmitLea(dest, a, static_cast<int32_t>(-b), code);
+						return Error::None;
+					}
+					break;
+				case Operation::Mul: {
+					// 3, 5 and 9 times a power of two are an lea and a shift
+					uint8_t shift = 0;
+					int64_t factor = b;
+					while (factor > 1 && factor % 2 == 0) {
+						factor /= 2;
+						++shift;
+					}
+					
+					if (factor == 3 || factor == 5 || factor == 9) {
+						Gen::EmitLea(dest, a, a, factor == 3 ? 1 : factor == 5 ? 2 : 3, 0, code);
+						if (shift > 0) Gen::EmitShl(dest, shift, code);
+					}
+					else if (factor == 1 && shift > 0) {
+						if (dest != a) Gen::EmitMov(dest, a, code);
+						Gen::EmitShl(dest, shift, code);
+					}
+					else if (b == 0) {
+						Gen::EmitXor(dest, dest, code);
+					}
+					else if (b == 1 || b == -1) {
+						if (dest != a) Gen::EmitMov(dest, a, code);
+						if (b == -1) Gen::EmitNeg(dest, code);
+					}
+					else {
+						Gen::EmitImul(dest, a, b, code);
+					}
+					return Error::None;
+				}
+				default: break;
+			}
+			
+			if (dest != a) Gen::EmitMov(dest, a, code);
+			switch (op) {
+				case Operation::Add: Gen::EmitAdd(dest, b, code);
+					break;
+				case Operation::Sub: Gen::EmitSub(dest, b, code);
+					break;
+				case Operation::And: Gen::EmitAnd(dest, b, code);
+					break;
+				case Operation::Or: Gen::EmitOr(dest, b, code);
+					break;
+				case Operation::Xor: Gen::EmitXor(dest, b, code);
+					break;
+				default: return Error{"Unsupported arithmetic operation type.", pos};
+			}
+			return Error::None;
+		}
+		
+		const Register b = second.reg;
+		if (a == b && (op == Operation::Sub || op == Operation::Xor)) {
+			Gen::EmitXor(dest, dest, code);
+			return Error::None;
+		}
+		if (op == Operation::Add && dest != a && dest != b) {
+			Gen::EmitLea(dest, a, b, 0, 0, code);
+			return Error::None;
+		}
+		if (op == Operation::Sub && dest == b) {
+			Gen::EmitNeg(dest, code);
+			Gen::EmitAdd(dest, a, code);
+			return Error::None;
+		}
+		
+		// Everything left is commutative apart from subtraction, which was handled when dest is b.
+		const Register other = dest == b ? a : b;
+		if (dest != a && dest != b) Gen::EmitMov(dest, a, code);
+		switch (op) {
+			case Operation::Add: Gen::EmitAdd(dest, other, code);
+				break;
+			case Operation::Sub: Gen::EmitSub(dest, other, code);
+				break;
+			case Operation::Mul: Gen::EmitImul(dest, other, code);
+				break;
+			case Operation::And: Gen::EmitAnd(dest, other, code);
+				break;
+			case Operation::Or: Gen::EmitOr(dest, other, code);
+				break;
+			case Operation::Xor: Gen::EmitXor(dest, other, code);
+				break;
+			default: return Error{"Unsupported arithmetic operation type.", pos};
+		}
+		return Error::None;
+	}
+	
+	// A register other than the ones to avoid, one that is dead after the statement if there is any.
+	Register ScratchRegister(const RegisterSet avoid, const RegisterSet live) {
+		const RegisterSet candidates = ALL_REGISTERS & ~avoid;
+		const RegisterSet dead = candidates & ~live;
+		const RegisterSet from = dead != 0 ? dead : candidates;
+		uint8_t i = 0;
+		while (!(from & (1u << i))) ++i;
+		return static_cast<Register>(i);
+	}
+	
+	/* NOTE narrow is set when the dividend and the divisor are known to fit in
+	 * 32 unsigned bits, with a nonzero divisor. Any division is still correct
+	 * without it.
+	 */
+	void CompileDivision(const std::optional<Register> quotient, const std::optional<Register> remainder, const IR::Value &dividend, const IR::Value &divisor,
+	                     const bool narrow, const RegisterSet live, MachineCode &code) {
+		// Division by zero is left to idiv so it still faults, and INT64_MIN has no positive counterpart to shift by.
+		if (dividend.tag == OperandTag::Register && divisor.tag == OperandTag::Immediate && divisor.value != 0 && divisor.value != INT64_MIN) {
+			CompileConstantDivision(quotient, remainder, dividend.reg, divisor.value, narrow, live, code);
+		}
+		else {
+			CompileIdiv(quotient, remainder, dividend, divisor, narrow, live, code);
+		}
+	}
+	
+	// Moves a quotient and a remainder to their destinations, which may be each other's registers.
+	void MoveDivisionResults(const std::optional<Register> quotient, const std::optional<Register> remainder, const Register q, const Register r, MachineCode &code) {
+		if (quotient == r && remainder == q) {
+			Gen::EmitXchg(q, r, code);
+		}
+		else if (quotient == r) {
+			if (remainder.has_value()) Gen::EmitMov(*remainder, r, code);
+			Gen::EmitMov(*quotient, q, code);
+		}
+		else {
+			if (quotient.has_value() && *quotient != q) Gen::EmitMov(*quotient, q, code);
+			if (remainder.has_value() && *remainder != r) Gen::EmitMov(*remainder, r, code);
+		}
+	}
+	
+	RegisterSet DivisionResults(const std::optional<Register> quotient, const std::optional<Register> remainder) {
+		return (quotient.has_value() ? RegisterBit(*quotient) : 0) | (remainder.has_value() ? RegisterBit(*remainder) : 0);
+	}
+	
+	/* NOTE idiv divides rdx:rax, so the dividend goes to rax and cqo extends
+	 * its sign into rdx. A divisor in any other register is used as it is; one
+	 * in rax or rdx, or an immediate, is moved to a scratch register first.
+	 * Of the registers this clobbers, only the ones live after the statement
+	 * are saved.
+	 *
+	 * The 64-bit idiv is several times slower than a 32-bit div, so narrow
+	 * divisions only use the latter. Others check at run time whether both
+	 * operands fit in 32 unsigned bits, and take the 32-bit div if they do.
+	 */
+	void CompileIdiv(const std::optional<Register> quotient, const std::optional<Register> remainder, const IR::Value &dividend, const IR::Value &divisor,
+	                 const bool narrow, const RegisterSet live, MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::rdx);
+		const RegisterSet results = DivisionResults(quotient, remainder);
+		RegisterSet saved = USED & live & ~results;
+		
+		Register source = divisor.reg;
+		if (divisor.tag == OperandTag::Immediate || (RegisterBit(divisor.reg) & USED)) {
+			RegisterSet avoid = USED | results;
+			if (dividend.tag == OperandTag::Register) avoid |= RegisterBit(dividend.reg);
+			source = ScratchRegister(avoid, live);
+			saved |= RegisterBit(source) & live;
+		}
+		
+		Gen::EmitPushRegs(saved, code);
+		if (divisor.tag == OperandTag::Immediate) Gen::EmitMov(source, divisor.value, code);
+		else if (source != divisor.reg) Gen::EmitMov(source, divisor.reg, code);
+		
+		if (dividend.tag == OperandTag::Immediate) Gen::EmitMov(Register::rax, dividend.value, code);
+		else if (dividend.reg != Register::rax) Gen::EmitMov(Register::rax, dividend.reg, code);
+		
+		// An immediate divisor is zero or INT64_MIN here, and a dividend outside 32 bits would never pass the check.
+		const bool check = divisor.tag == OperandTag::Register && (dividend.tag == OperandTag::Register || (dividend.value >= 0 && dividend.value <= UINT32_MAX));
+		if (narrow) {
+			Gen::EmitXor32(Register::rdx, Register::rdx, code);
+			Gen::EmitDiv32(source, code);
+		}
+		else if (check) {
+			Gen::EmitMov(Register::rdx, Register::rax, code);
+			Gen::EmitOr(Register::rdx, source, code);
+			Gen::EmitShr(Register::rdx, 32, code);
+			const size_t wide = code.size();
+			Gen::EmitNop(6, code);
+			
+			Gen::EmitXor32(Register::rdx, Register::rdx, code);
+			Gen::EmitDiv32(source, code);
+			const size_t done = code.size();
+			Gen::EmitNop(5, code);
+			
+			Gen::WriteJump(wide, code.size(), static_cast<uint8_t>(Comparison::NotEquals), code);
+			Gen::EmitCqo(code);
+			Gen::EmitIdiv(source, code);
+			Gen::WriteJump(done, code.size(), code);
+		}
+		else {
+			Gen::EmitCqo(code);
+			Gen::EmitIdiv(source, code);
+		}
+		
+		MoveDivisionResults(quotient, remainder, Register::rax, Register::rdx, code);
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	struct DivisionMagic {
+		int64_t multiplier;
+		uint8_t shift;
+	};
+	
+	/* NOTE The multiplier and shift for signed division by a constant of at
+	 * least 2 in magnitude, as in Hacker's Delight, chapter 10. The quotient is
+	 * the high half of dividend * multiplier, corrected by the dividend when
+	 * the multiplier's sign doesn't match the divisor's, shifted right and
+	 * rounded towards zero.
+	 */
+	DivisionMagic ComputeDivisionMagic(const int64_t divisor) {
+		constexpr uint64_t TWO_63 = UINT64_C(1) << 63;
+		const uint64_t magnitude = divisor < 0 ? 0 - static_cast<uint64_t>(divisor) : static_cast<uint64_t>(divisor);
+		const uint64_t t = TWO_63 + (static_cast<uint64_t>(divisor) >> 63);
+		const uint64_t anc = t - 1 - t % magnitude;
+		
+		uint64_t q1 = TWO_63 / anc;
+		uint64_t r1 = TWO_63 - q1 * anc;
+		uint64_t q2 = TWO_63 / magnitude;
+		uint64_t r2 = TWO_63 - q2 * magnitude;
+		uint64_t delta;
+		uint8_t p = 63;
+		do {
+			++p;
+			q1 *= 2;
+			r1 *= 2;
+			if (r1 >= anc) {
+				++q1;
+				r1 -= anc;
+			}
+			q2 *= 2;
+			r2 *= 2;
+			if (r2 >= magnitude) {
+				++q2;
+				r2 -= magnitude;
+			}
+			delta = magnitude - r2;
+		} while (q1 < delta || (q1 == delta && r1 == 0));
+		
+		const uint64_t multiplier = q2 + 1;
+		return DivisionMagic{static_cast<int64_t>(divisor < 0 ? 0 - multiplier : multiplier), static_cast<uint8_t>(p - 64)};
+	}
+	
+	/* NOTE Division by a constant without idiv. A single result by a power of
+	 * two is a shift, after adding divisor - 1 to negative dividends so the
+	 * quotient rounds towards zero like idiv does; the remainder subtracts the
+	 * rounded down multiple. Anything else multiplies by a magic number into
+	 * rdx, and the remainder multiplies the quotient back. Only the registers
+	 * this clobbers that are live afterwards are saved.
+	 */
+	void CompileConstantDivision(const std::optional<Register> quotient, const std::optional<Register> remainder, const Register dividend, const int64_t divisor,
+	                             const bool narrow, const RegisterSet live, MachineCode &code) {
+		if (divisor == 1 || divisor == -1) {
+			if (quotient.has_value()) {
+				if (*quotient != dividend) Gen::EmitMov(*quotient, dividend, code);
+				if (divisor == -1) Gen::EmitNeg(*quotient, code);
+			}
+			if (remainder.has_value()) Gen::EmitXor(*remainder, *remainder, code);
+			return;
+		}
+		
+		const uint64_t magnitude = divisor < 0 ? 0 - static_cast<uint64_t>(divisor) : static_cast<uint64_t>(divisor);
+		if ((magnitude & (magnitude - 1)) == 0 && quotient.has_value() != remainder.has_value()) {
+			const Register dest = quotient.has_value() ? *quotient : *remainder;
+			uint8_t shift = 0;
+			while ((UINT64_C(1) << shift) != magnitude) ++shift;
+			
+			// A dividend that can't be negative needs no rounding
+			if (narrow) {
+				if (dest != dividend) Gen::EmitMov(dest, dividend, code);
+				if (quotient.has_value()) Gen::EmitShr(dest, shift, code);
+				else Gen::EmitAnd(dest, static_cast<int64_t>(magnitude - 1), code);
+				return;
+			}
+			
+			// The bias is divisor - 1 for negative dividends and 0 otherwise, built in dest unless that is the dividend.
+			const Register bias = dest != dividend ? dest : ScratchRegister(RegisterBit(dest), live);
+			const RegisterSet saved = bias != dest ? RegisterBit(bias) & live : 0;
+			
+			Gen::EmitPushRegs(saved, code);
+			Gen::EmitMov(bias, dividend, code);
+			if (shift > 1) Gen::EmitSar(bias, 63, code);
+			Gen::EmitShr(bias, static_cast<uint8_t>(64 - shift), code);
+			if (quotient.has_value()) {
+				Gen::EmitAdd(dest, bias != dest ? bias : dividend, code);
+				Gen::EmitSar(dest, shift, code);
+				if (divisor < 0) Gen::EmitNeg(dest, code);
+			}
+			else {
+				Gen::EmitAdd(bias, dividend, code);
+				Gen::EmitAnd(bias, static_cast<int64_t>(0 - magnitude), code);
+				if (bias == dest) {
+					Gen::EmitNeg(dest, code);
+					Gen::EmitAdd(dest, dividend, code);
+				}
+				else {
+					Gen::EmitSub(dest, bias, code);
+				}
+			}
+			Gen::EmitPopRegs(saved, code);
+			return;
+		}
+		
+		const DivisionMagic magic = ComputeDivisionMagic(divisor);
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::rdx);
+		const RegisterSet results = DivisionResults(quotient, remainder);
+		RegisterSet saved = USED & live & ~results;
+		
+		// The dividend is needed after the multiply, so it can't stay in rax or rdx. A destination outside them is free until the end.
+		Register source = dividend;
+		if (RegisterBit(dividend) & USED) {
+			if (quotient.has_value() && !(RegisterBit(*quotient) & USED)) source = *quotient;
+			else if (remainder.has_value() && !(RegisterBit(*remainder) & USED)) source = *remainder;
+			else source = ScratchRegister(USED | results, live);
+			if (!(RegisterBit(source) & results)) saved |= RegisterBit(source) & live;
+		}
+		
+		Gen::EmitPushRegs(saved, code);
+		if (source != dividend) Gen::EmitMov(source, dividend, code);
+		Gen::EmitMov(Register::rax, magic.multiplier, code);
+		Gen::EmitImul(source, code);
+		if (divisor > 0 && magic.multiplier < 0) Gen::EmitAdd(Register::rdx, source, code);
+		if (divisor < 0 && magic.multiplier > 0) Gen::EmitSub(Register::rdx, source, code);
+		if (magic.shift > 0) Gen::EmitSar(Register::rdx, magic.shift, code);
+		if (!narrow) {
+			Gen::EmitMov(Register::rax, Register::rdx, code);
+			Gen::EmitShr(Register::rax, 63, code);
+			Gen::EmitAdd(Register::rdx, Register::rax, code);
+		}
+		
+		// The quotient is in rdx. The remainder goes to rax when the quotient is kept too, and replaces it otherwise.
+		const Register r = quotient.has_value() ? Register::rax : Register::rdx;
+		if (remainder.has_value()) {
+			if (r != Register::rdx) Gen::EmitMov(r, Register::rdx, code);
+			Gen::EmitImul(r, r, divisor, code);
+			Gen::EmitNeg(r, code);
+			Gen::EmitAdd(r, source, code);
+		}
+		MoveDivisionResults(quotient, remainder, Register::rdx, r, code);
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	void CompileText(const std::string &text, const RegisterSet live, MachineCode &code) {
+		const size_t length = text.length();
+		if (length == 0) return;
+		
+		const size_t textPtr = AddString(text);
+		
+		// There is no runtime call to fall back to, copy text longer than the buffer piece by piece.
+		if (Options::flag_freestanding) {
+			const size_t chunk = std::min<size_t>(Options::outputBufferSize, INT32_MAX);
+			for (size_t offset = 0; offset < length; offset += chunk) {
+				CompileBufferedText(textPtr + offset, std::min(chunk, length - offset), live, code);
+			}
+			return;
+		}
+		
+		if (Options::outputBufferSize != 0 && length <= Options::outputBufferSize && length <= INT32_MAX) {
+			CompileBufferedText(textPtr, length, live, code);
+			return;
+		}
+		
+		void (*fn)(const char *, size_t) = &Print;
+		int64_t addr;
+		memcpy(&addr, &fn, 8);
+		
+		const RegisterSet saved = CALLER_SAVED & live;
+		Gen::EmitPushRegs(saved, code);
+		
+		Gen::EmitLeaData(Register::rdi, Section::ReadOnly, textPtr, code);
+		Gen::EmitMov(Register::rsi, (int64_t) length, code);
+		Gen::EmitAlignedCall(addr, code);
+		
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	/* NOTE Appends the text directly to the runtime output buffer. Only the live
+	 * registers used by the copy are saved, the flush stub preserves the rest.
+	 */
+	void CompileBufferedText(const size_t textPtr, const size_t length, const RegisterSet live, MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rsi) | RegisterBit(Register::rdi);
+		const RegisterSet saved = USED & live;
+		
+		const auto cursorOffset = static_cast<int32_t>(offsetof(OutputBuffer, cursor));
+		const auto endOffset = static_cast<int32_t>(offsetof(OutputBuffer, end));
+		
+		Gen::EmitPushRegs(saved, code);
+		
+		CompileOutputDescriptor(Register::rax, code);
+		Gen::EmitMovLoad(Register::rdi, Register::rax, cursorOffset, code);
+		Gen::EmitLea(Register::rcx, Register::rdi, static_cast<int32_t>(length), code);
+		
+		Gen::EmitCmpLoad(Register::rcx, Register::rax, endOffset, code);
+		const size_t fitsJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		
+		const size_t flushCallPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteCall(flushCallPtr, flushStubPtr, code);
+		Gen::EmitMovLoad(Register::rdi, Register::rax, cursorOffset, code);
+		
+		Gen::WriteJump(fitsJumpPtr, code.length(), Comparison::LessEquals, false, code);
+		Gen::EmitLeaData(Register::rsi, Section::ReadOnly, textPtr, code);
+		Gen::EmitMov(Register::rcx, static_cast<int64_t>(length), code);
+		Gen::EmitRepMovsb(code);
+		Gen::EmitMovStore(Register::rax, cursorOffset, Register::rdi, code);
+		
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	/* NOTE Formats the value straight into the runtime output buffer, two digits
+	 * per step. Digits are produced backwards into the red zone and then copied
+	 * with two unaligned 16 byte moves, so there is no loop over the length.
+	 */
+	void CompileInlinePrint(const Register source, const RegisterSet live, MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rdx) | RegisterBit(Register::rsi)
+		                             | RegisterBit(Register::rdi) | RegisterBit(Register::r8) | RegisterBit(Register::r9) | RegisterBit(Register::r11);
+		const RegisterSet saved = USED & live;
+		constexpr uint8_t JB = 0x72;
+		constexpr uint8_t JNS = 0x79;
+		constexpr int64_t DIGITS_END = -4; // [rsp-32], in qwords
+		constexpr int32_t COPY_SIZE = 32;
+		
+		const size_t pairsPtr = AddString(std::string(DIGIT_PAIRS, 200));
+		
+		const auto cursorOffset = static_cast<int32_t>(offsetof(OutputBuffer, cursor));
+		const auto endOffset = static_cast<int32_t>(offsetof(OutputBuffer, end));
+		bool inverted = false;
+		
+		Gen::EmitPushRegs(saved, code);
+		if (source != Register::rax) Gen::EmitMov(Register::rax, source, code);
+		
+		// Make room for the sign and the fixed size copy.
+		CompileOutputDescriptor(Register::r11, code);
+		Gen::EmitMovLoad(Register::rsi, Register::r11, cursorOffset, code);
+		Gen::EmitLea(Register::rcx, Register::rsi, COPY_SIZE + 1, code);
+		Gen::EmitCmpLoad(Register::rcx, Register::r11, endOffset, code);
+		const size_t fitsJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		const size_t flushCallPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteCall(flushCallPtr, flushStubPtr, code);
+		Gen::EmitMovLoad(Register::rsi, Register::r11, cursorOffset, code);
+		Gen::WriteJump(fitsJumpPtr, code.length(), Comparison::LessEquals, false, code);
+		
+		// Sign. Negating INT64_MIN leaves 2^63, which is correct when treated as unsigned.
+		Gen::EmitTest(Register::rax, Register::rax, code);
+		const size_t positiveJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMovByteStore(Register::rsi, 0, '-', code);
+		Gen::EmitAdd(Register::rsi, 1, code);
+		Gen::EmitNeg(Register::rax, code);
+		Gen::WriteJump(positiveJumpPtr, code.length(), JNS, code);
+		
+		Gen::EmitLeaStack(Register::rdi, DIGITS_END, code);
+		Gen::EmitLeaData(Register::r8, Section::ReadOnly, pairsPtr, code);
+		Gen::EmitMov(Register::r9, INT64_C(0x28F5C28F5C28F5C3), code);
+		
+		// Two digits per iteration: q = ((x >> 2) * magic) >> 66 = x / 100.
+		const size_t loopPtr = code.length();
+		Gen::EmitCmp(Register::rax, 100, code, inverted);
+		const size_t tailJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMov(Register::rcx, Register::rax, code);
+		Gen::EmitShr(Register::rax, 2, code);
+		Gen::EmitMul(Register::r9, code);
+		Gen::EmitShr(Register::rdx, 2, code);
+		Gen::EmitImul(Register::rax, Register::rdx, 100, code);
+		Gen::EmitSub(Register::rcx, Register::rax, code);
+		Gen::EmitMov(Register::rax, Register::rdx, code);
+		Gen::EmitMovzxWordLoad(Register::rdx, Register::r8, Register::rcx, 1, code);
+		Gen::EmitSub(Register::rdi, 2, code);
+		Gen::EmitMovWordStore(Register::rdi, 0, Register::rdx, code);
+		const size_t loopJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteJump(loopJumpPtr, loopPtr, code);
+		
+		// Last one or two digits.
+		Gen::WriteJump(tailJumpPtr, code.length(), JB, code);
+		Gen::EmitCmp(Register::rax, 10, code, inverted);
+		const size_t singleJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMovzxWordLoad(Register::rdx, Register::r8, Register::rax, 1, code);
+		Gen::EmitSub(Register::rdi, 2, code);
+		Gen::EmitMovWordStore(Register::rdi, 0, Register::rdx, code);
+		const size_t copyJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteJump(singleJumpPtr, code.length(), JB, code);
+		Gen::EmitAdd(Register::rax, '0', code);
+		Gen::EmitSub(Register::rdi, 1, code);
+		Gen::EmitMovByteStore(Register::rdi, 0, Register::rax, code);
+		Gen::WriteJump(copyJumpPtr, code.length(), code);
+		
+		Gen::EmitMovdquLoad(0, Register::rdi, 0, code);
+		Gen::EmitMovdquLoad(1, Register::rdi, 16, code);
+		Gen::EmitMovdquStore(Register::rsi, 0, 0, code);
+		Gen::EmitMovdquStore(Register::rsi, 16, 1, code);
+		Gen::EmitLeaStack(Register::rcx, DIGITS_END, code);
+		Gen::EmitSub(Register::rcx, Register::rdi, code);
+		Gen::EmitAdd(Register::rsi, Register::rcx, code);
+		Gen::EmitMovStore(Register::r11, cursorOffset, Register::rsi, code);
+		
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	/* NOTE Copies the bytes into the output buffer when they fit. Otherwise the
+	 * write stub takes over, which flushes the buffer and either copies the
+	 * bytes after all or writes them out directly. The count is unsigned.
+	 */
+	[[nodiscard]] Error CompileBytes(const Parser::StdoutBytesStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rdx) | RegisterBit(Register::rsi)
+		                             | RegisterBit(Register::rdi);
+		constexpr uint8_t JA = 0x77;
+		const bool buffered = Options::outputBufferSize != 0;
+		const RegisterSet saved = (buffered ? USED : RegisterBit(Register::rcx) | RegisterBit(Register::rsi)) & live;
+		
+		const auto cursorOffset = static_cast<int32_t>(offsetof(OutputBuffer, cursor));
+		const auto endOffset = static_cast<int32_t>(offsetof(OutputBuffer, end));
+		bool inverted = false;
+		
+		Gen::EmitPushRegs(saved, code);
+		
+		// Address goes to rsi and the count to rcx, either of which may hold the other.
+		switch (statement.length->tag) {
+			case OperandTag::Register: {
+				const Register length = dynamic_cast<const RegisterOperand &>(*statement.length).reg;
+				if (length == Register::rsi && statement.address == Register::rcx) {
+					Gen::EmitXchg(Register::rsi, Register::rcx, code);
+				}
+				else if (length == Register::rsi) {
+					Gen::EmitMov(Register::rcx, Register::rsi, code);
+					Gen::EmitMov(Register::rsi, statement.address, code);
+				}
+				else {
+					if (statement.address != Register::rsi) Gen::EmitMov(Register::rsi, statement.address, code);
+					if (length != Register::rcx) Gen::EmitMov(Register::rcx, length, code);
+				}
+				break;
+			}
+			case OperandTag::Immediate: {
+				const int64_t length = dynamic_cast<const ImmediateOperand &>(*statement.length).value;
+				if (length < 0) return Error{"Byte count can't be negative.", statement.length->pos};
+				if (statement.address != Register::rsi) Gen::EmitMov(Register::rsi, statement.address, code);
+				Gen::EmitMov(Register::rcx, length, code);
+				break;
+			}
+			default: return Error{"Unsopported source argument type.", statement.pos};
+		}
+		
+		if (!buffered) {
+			const size_t writeCallPtr = code.length();
+			Gen::EmitNop(5, code);
+			Gen::WriteCall(writeCallPtr, writeStubPtr, code);
+			Gen::EmitPopRegs(saved, code);
+			return Error::None;
+		}
+		
+		CompileOutputDescriptor(Register::rax, code);
+		Gen::EmitMovLoad(Register::rdi, Register::rax, cursorOffset, code);
+		Gen::EmitMovLoad(Register::rdx, Register::rax, endOffset, code);
+		Gen::EmitSub(Register::rdx, Register::rdi, code);
+		Gen::EmitCmp(Register::rcx, Register::rdx, code, inverted);
+		const size_t slowJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitRepMovsb(code);
+		Gen::EmitMovStore(Register::rax, cursorOffset, Register::rdi, code);
+		const size_t doneJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		
+		Gen::WriteJump(slowJumpPtr, code.length(), JA, code);
+		const size_t writeCallPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteCall(writeCallPtr, writeStubPtr, code);
+		
+		Gen::WriteJump(doneJumpPtr, code.length(), code);
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	/* NOTE The mapping comes back in rax and rdx. Neither destination is saved,
+	 * both are overwritten anyway.
+	 */
+	void CompileMapFile(const Parser::MapFileStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr RegisterSet STUB_CLOBBERED = RegisterBit(Register::rax) | RegisterBit(Register::rdx) | RegisterBit(Register::rdi);
+		const RegisterSet saved = (Options::flag_freestanding ? STUB_CLOBBERED : CALLER_SAVED) & live
+		                          & ~RegisterBit(statement.address) & ~RegisterBit(statement.length);
+		
+		Gen::EmitPushRegs(saved, code);
+		Gen::EmitLeaData(Register::rdi, Section::ReadOnly, AddString(statement.path + '\0'), code);
+		
+		if (Options::flag_freestanding) {
+			const size_t mapCallPtr = code.length();
+			Gen::EmitNop(5, code);
+			Gen::WriteCall(mapCallPtr, mapFileStubPtr, code);
+		}
+		else {
+			MappedFile (*fn)(const char *) = &MapFile;
+			int64_t addr;
+			memcpy(&addr, &fn, 8);
+			Gen::EmitAlignedCall(addr, code);
+		}
+		
+		if (statement.address == Register::rdx && statement.length == Register::rax) {
+			Gen::EmitXchg(Register::rax, Register::rdx, code);
+		}
+		else if (statement.address == Register::rdx) {
+			Gen::EmitMov(statement.length, Register::rdx, code);
+			Gen::EmitMov(Register::rdx, Register::rax, code);
+		}
+		else {
+			if (statement.address != Register::rax) Gen::EmitMov(statement.address, Register::rax, code);
+			if (statement.length != Register::rdx) Gen::EmitMov(statement.length, Register::rdx, code);
+		}
+		
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	/* NOTE Bumps the arena cursor inline. Sizes are rounded up to
+	 * ARENA_ALIGNMENT, so every allocation is aligned. The grow stub is only
+	 * called when the new cursor passes the committed end, or when the size
+	 * or its rounding wraps around the address space, which the runtime
+	 * reports as an error.
+	 */
+	[[nodiscard]] Error CompileAlloc(const Parser::AllocStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr uint8_t JB = 0x72;
+		constexpr uint8_t JBE = 0x76;
+		constexpr Register SCRATCH[] = {Register::r11, Register::r10, Register::r9, Register::rax};
+		
+		RegisterSet excluded = RegisterBit(statement.dest);
+		if (statement.size->tag == OperandTag::Register) excluded |= RegisterBit(dynamic_cast<const RegisterOperand &>(*statement.size).reg);
+		
+		// Descriptor and new cursor, neither of them the destination or the size.
+		Register scratch[2];
+		size_t found = 0;
+		for (const Register reg: SCRATCH) {
+			if (found < 2 && !(excluded & RegisterBit(reg))) scratch[found++] = reg;
+		}
+		const Register descriptor = scratch[0];
+		const Register next = scratch[1];
+		const RegisterSet saved = (RegisterBit(descriptor) | RegisterBit(next)) & live;
+		
+		const auto cursorOffset = static_cast<int32_t>(offsetof(Arena, cursor));
+		const auto endOffset = static_cast<int32_t>(offsetof(Arena, end));
+		size_t roundJumpPtr = 0;
+		size_t wrapJumpPtr = 0;
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileArenaDescriptor(descriptor, code);
+		
+		switch (statement.size->tag) {
+			case OperandTag::Register: {
+				const Register size = dynamic_cast<const RegisterOperand &>(*statement.size).reg;
+				// The carry out of the rounding leaves a value below the cursor in next.
+				Gen::EmitMov(next, size, code);
+				Gen::EmitAdd(next, ARENA_ALIGNMENT - 1, code);
+				roundJumpPtr = code.length();
+				Gen::EmitNop(6, code);
+				Gen::EmitAnd(next, -ARENA_ALIGNMENT, code);
+				Gen::EmitMovLoad(statement.dest, descriptor, cursorOffset, code);
+				Gen::EmitAdd(next, statement.dest, code);
+				wrapJumpPtr = code.length();
+				Gen::EmitNop(6, code);
+				break;
+			}
+			case OperandTag::Immediate: {
+				const int64_t size = dynamic_cast<const ImmediateOperand &>(*statement.size).value;
+				if (size < 0 || size > INT32_MAX - ARENA_ALIGNMENT) return Error{"Allocation size out of range.", statement.size->pos};
+				const int64_t rounded = (size + ARENA_ALIGNMENT - 1) & -ARENA_ALIGNMENT;
+				Gen::EmitMovLoad(statement.dest, descriptor, cursorOffset, code);
+				Gen::EmitLea(next, statement.dest, static_cast<int32_t>(rounded), code);
+				break;
+			}
+			default: return Error{"Unsopported source argument type.", statement.pos};
+		}
+		
+		Gen::EmitCmpLoad(next, descriptor, endOffset, code);
+		const size_t fitsJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		
+		if (roundJumpPtr) Gen::WriteJump(roundJumpPtr, code.length(), JB, code);
+		if (wrapJumpPtr) Gen::WriteJump(wrapJumpPtr, code.length(), JB, code);
+		if (next != Register::rdi) {
+			Gen::EmitPush(Register::rdi, code);
+			Gen::EmitMov(Register::rdi, next, code);
+		}
+		const size_t growCallPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteCall(growCallPtr, growArenaStubPtr, code);
+		if (next != Register::rdi) Gen::EmitPop(Register::rdi, code);
+		
+		Gen::WriteJump(fitsJumpPtr, code.length(), JBE, code);
+		Gen::EmitMovStore(descriptor, cursorOffset, next, code);
+		
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	void CompileReset(const RegisterSet live, MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::r11);
+		const RegisterSet saved = USED & live;
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileArenaDescriptor(Register::r11, code);
+		Gen::EmitMovLoad(Register::rax, Register::r11, static_cast<int32_t>(offsetof(Arena, begin)), code);
+		Gen::EmitMovStore(Register::r11, static_cast<int32_t>(offsetof(Arena, cursor)), Register::rax, code);
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	/* NOTE Moves register operands of a memory statement into the registers its
+	 * code expects. They go through the stack, so any of them may already hold
+	 * another one's value.
+	 */
+	void CompileBlockOperands(const std::vector<std::pair<Register, Register>> &moves, MachineCode &code) {
+		bool inPlace = true;
+		for (const auto &[target, source]: moves) inPlace &= target == source;
+		if (inPlace) return;
+		
+		for (const auto &move: moves) Gen::EmitPush(move.second, code);
+		for (auto it = moves.rbegin(); it != moves.rend(); ++it) Gen::EmitPop(it->first, code);
+	}
+	
+	// Byte counts go to rcx; immediate ones are returned to pick a single size class.
+	[[nodiscard]] Error GetBlockCount(const Operand &operand, std::vector<std::pair<Register, Register>> &moves, std::optional<int64_t> &count) {
+		switch (operand.tag) {
+			case OperandTag::Register: moves.emplace_back(Register::rcx, dynamic_cast<const RegisterOperand &>(operand).reg);
+				return Error::None;
+			case OperandTag::Immediate: {
+				const int64_t value = dynamic_cast<const ImmediateOperand &>(operand).value;
+				if (value < 0) return Error{"Byte count can't be negative.", operand.pos};
+				count = value;
+				return Error::None;
+			}
+			default: return Error{"Unsopported source argument type.", operand.pos};
+		}
+	}
+	
+	BlockSize ClassifyBlock(const int64_t count, const bool wordMoves, const bool repString) {
+		if (repString && count >= BLOCK_REP_MIN) return BlockSize::Rep;
+		if (count >= BLOCK_VECTOR_MIN) return BlockSize::Vector;
+		if (wordMoves && count >= 8) return BlockSize::Words;
+		return BlockSize::Bytes;
+	}
+	
+	/* NOTE Emits the code for each size class a statement might need, with the
+	 * count in rcx. An immediate count compiles to its class alone, a register
+	 * one dispatches at run time with vectors as the fall-through case. Every
+	 * class ends where the next statement begins.
+	 */
+	template<typename EmitClass>
+	void CompileBlockClasses(const std::optional<int64_t> count, const bool wordMoves, const bool repString, EmitClass emitClass, MachineCode &code) {
+		constexpr uint8_t JB = 0x72;
+		constexpr uint8_t JAE = 0x73;
+		
+		if (count.has_value()) {
+			emitClass(ClassifyBlock(*count, wordMoves, repString));
+			return;
+		}
+		
+		struct Dispatch {
+			size_t jumpPtr;
+			uint8_t opcode;
+			BlockSize size;
+		};
+		std::vector<Dispatch> dispatches;
+		const auto compileDispatch = [&](const int64_t bound, const uint8_t opcode, const BlockSize size) {
+			bool inverted = false;
+			Gen::EmitCmp(Register::rcx, bound, code, inverted);
+			dispatches.push_back(Dispatch{code.length(), opcode, size});
+			Gen::EmitNop(6, code);
+		};
+		
+		if (wordMoves) compileDispatch(8, JB, BlockSize::Bytes);
+		compileDispatch(BLOCK_VECTOR_MIN, JB, wordMoves ? BlockSize::Words : BlockSize::Bytes);
+		if (repString) compileDispatch(BLOCK_REP_MIN, JAE, BlockSize::Rep);
+		
+		std::vector<size_t> doneJumps;
+		emitClass(BlockSize::Vector);
+		for (const Dispatch &dispatch: dispatches) {
+			doneJumps.push_back(code.length());
+			Gen::EmitNop(5, code);
+			Gen::WriteJump(dispatch.jumpPtr, code.length(), dispatch.opcode, code);
+			emitClass(dispatch.size);
+		}
+		for (const size_t jumpPtr: doneJumps) Gen::WriteJump(jumpPtr, code.length(), code);
+	}
+	
+	/* NOTE Ends a compare or find class. Falling through means nothing was found
+	 * and gives -1 in rax. Found jumps come with the index of the 16 bytes in rdx
+	 * and a bit mask of matches in rax when vectorMask is set, or the index
+	 * itself in rdx otherwise.
+	 */
+	void CompileBlockIndex(const std::vector<std::pair<size_t, uint8_t>> &foundJumps, const bool vectorMask, MachineCode &code) {
+		Gen::EmitMov(Register::rax, -1, code);
+		const size_t endJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		
+		for (const auto &[jumpPtr, opcode]: foundJumps) Gen::WriteJump(jumpPtr, code.length(), opcode, code);
+		if (vectorMask) {
+			Gen::EmitBsf(Register::rax, Register::rax, code);
+			Gen::EmitAdd(Register::rax, Register::rdx, code);
+		}
+		else {
+			Gen::EmitMov(Register::rax, Register::rdx, code);
+		}
+		Gen::WriteJump(endJumpPtr, code.length(), code);
+	}
+	
+	/* NOTE Copies rcx bytes from rsi to rdi. Ranges must not overlap. Medium
+	 * sizes copy 16 bytes at a time and finish with the last 16 bytes, loaded up
+	 * front, instead of a scalar tail.
+	 */
+	[[nodiscard]] Error CompileCopy(const Parser::CopyStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr uint8_t JA = 0x77;
+		constexpr uint8_t JNE = 0x75;
+		constexpr uint8_t JE = 0x74;
+		const RegisterSet saved = BLOCK_USED & live;
+		
+		std::vector<std::pair<Register, Register>> moves{{Register::rdi, statement.dest}, {Register::rsi, statement.source}};
+		std::optional<int64_t> count;
+		Error _error = (GetBlockCount(*statement.count, moves, count));
+		if (_error)return _error;
+		if (count == 0) return Error::None;
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileBlockOperands(moves, code);
+		if (count.has_value()) Gen::EmitMov(Register::rcx, *count, code);
+		
+		const auto compileClass = [&](const BlockSize size) {
+			switch (size) {
+				case BlockSize::Bytes: {
+					Gen::EmitTest(Register::rcx, Register::rcx, code);
+					const size_t emptyJumpPtr = code.length();
+					Gen::EmitNop(6, code);
+					const size_t loopPtr = code.length();
+					Gen::EmitMovzxByteLoad(Register::rax, Register::rsi, 0, code);
+					Gen::EmitMovByteStore(Register::rdi, 0, Register::rax, code);
+					Gen::EmitAdd(Register::rsi, 1, code);
+					Gen::EmitAdd(Register::rdi, 1, code);
+					Gen::EmitSub(Register::rcx, 1, code);
+					const size_t loopJumpPtr = code.length();
+					Gen::EmitNop(6, code);
+					Gen::WriteJump(loopJumpPtr, loopPtr, JNE, code);
+					Gen::WriteJump(emptyJumpPtr, code.length(), JE, code);
+					break;
+				}
+				case BlockSize::Words:
+					Gen::EmitMovLoad(Register::rax, Register::rsi, 0, code);
+					Gen::EmitAdd(Register::rsi, Register::rcx, code);
+					Gen::EmitMovLoad(Register::rdx, Register::rsi, -8, code);
+					Gen::EmitMovStore(Register::rdi, 0, Register::rax, code);
+					Gen::EmitAdd(Register::rdi, Register::rcx, code);
+					Gen::EmitMovStore(Register::rdi, -8, Register::rdx, code);
+					break;
+				case BlockSize::Vector: {
+					Gen::EmitMov(Register::rax, Register::rsi, code);
+					Gen::EmitAdd(Register::rax, Register::rcx, code);
+					Gen::EmitMovdquLoad(1, Register::rax, -16, code);
+					Gen::EmitMov(Register::rdx, Register::rdi, code);
+					Gen::EmitAdd(Register::rdx, Register::rcx, code);
+					
+					const size_t loopPtr = code.length();
+					Gen::EmitMovdquLoad(0, Register::rsi, 0, code);
+					Gen::EmitMovdquStore(Register::rdi, 0, 0, code);
+					Gen::EmitAdd(Register::rsi, 16, code);
+					Gen::EmitAdd(Register::rdi, 16, code);
+					Gen::EmitSub(Register::rcx, 16, code);
+					bool inverted = false;
+					Gen::EmitCmp(Register::rcx, 16, code, inverted);
+					const size_t loopJumpPtr = code.length();
+					Gen::EmitNop(6, code);
+					Gen::WriteJump(loopJumpPtr, loopPtr, JA, code);
+					
+					Gen::EmitMovdquStore(Register::rdx, -16, 1, code);
+					break;
+				}
+				case BlockSize::Rep: Gen::EmitRepMovsb(code);
+					break;
+			}
+		};
+		CompileBlockClasses(count, true, true, compileClass, code);
+		
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	// Sets rcx bytes at rdi to the low byte of rax.
+	[[nodiscard]] Error CompileFill(const Parser::FillStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr uint8_t JA = 0x77;
+		constexpr uint8_t JNE = 0x75;
+		constexpr uint8_t JE = 0x74;
+		constexpr int64_t BYTE_PATTERN = 0x0101010101010101;
+		const RegisterSet saved = BLOCK_USED & live;
+		
+		std::vector<std::pair<Register, Register>> moves{{Register::rdi, statement.dest}};
+		std::optional<int64_t> count;
+		Error _error = (GetBlockCount(*statement.count, moves, count));
+		if (_error)return _error;
+		if (count == 0) return Error::None;
+		
+		// An immediate value is broadcast to every byte of rax here, a register one only when wider moves need it.
+		std::optional<int64_t> pattern;
+		switch (statement.value->tag) {
+			case OperandTag::Register: moves.emplace_back(Register::rax, dynamic_cast<const RegisterOperand &>(*statement.value).reg);
+				break;
+			case OperandTag::Immediate: pattern = (dynamic_cast<const ImmediateOperand &>(*statement.value).value & 0xFF) * BYTE_PATTERN;
+				break;
+			default: return Error{"Unsopported source argument type.", statement.pos};
+		}
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileBlockOperands(moves, code);
+		if (count.has_value()) Gen::EmitMov(Register::rcx, *count, code);
+		if (pattern.has_value()) Gen::EmitMov(Register::rax, *pattern, code);
+		
+		const auto compileBroadcast = [&]() {
+			if (pattern.has_value()) return;
+			Gen::EmitAnd(Register::rax, 0xFF, code);
+			Gen::EmitImul(Register::rax, Register::rax, BYTE_PATTERN, code);
+		};
+		
+		const auto compileClass = [&](const BlockSize size) {
+			switch (size) {
+				case BlockSize::Bytes: {
+					Gen::EmitTest(Register::rcx, Register::rcx, code);
+					const size_t emptyJumpPtr = code.length();
+					Gen::EmitNop(6, code);
+					const size_t loopPtr = code.length();
+					Gen::EmitMovByteStore(Register::rdi, 0, Register::rax, code);
+					Gen::EmitAdd(Register::rdi, 1, code);
+					Gen::EmitSub(Register::rcx, 1, code);
+					const size_t loopJumpPtr = code.length();
+					Gen::EmitNop(6, code);
+					Gen::WriteJump(loopJumpPtr, loopPtr, JNE, code);
+					Gen::WriteJump(emptyJumpPtr, code.length(), JE, code);
+					break;
+				}
+				case BlockSize::Words:
+					compileBroadcast();
+					Gen::EmitMovStore(Register::rdi, 0, Register::rax, code);
+					Gen::EmitAdd(Register::rdi, Register::rcx, code);
+					Gen::EmitMovStore(Register::rdi, -8, Register::rax, code);
+					break;
+				case BlockSize::Vector: {
+					compileBroadcast();
+					Gen::EmitMovq(0, Register::rax, code);
+					Gen::EmitPunpcklqdq(0, 0, code);
+					Gen::EmitMov(Register::rdx, Register::rdi, code);
+					Gen::EmitAdd(Register::rdx, Register::rcx, code);
+					
+					const size_t loopPtr = code.length();
+					Gen::EmitMovdquStore(Register::rdi, 0, 0, code);
+					Gen::EmitAdd(Register::rdi, 16, code);
+					Gen::EmitSub(Register::rcx, 16, code);
+					bool inverted = false;
+					Gen::EmitCmp(Register::rcx, 16, code, inverted);
+					const size_t loopJumpPtr = code.length();
+					Gen::EmitNop(6, code);
+					Gen::WriteJump(loopJumpPtr, loopPtr, JA, code);
+					
+					Gen::EmitMovdquStore(Register::rdx, -16, 0, code);
+					break;
+				}
+				case BlockSize::Rep: Gen::EmitRepStosb(code);
+					break;
+			}
+		};
+		CompileBlockClasses(count, true, true, compileClass, code);
+		
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	/* NOTE Finds the index of the first byte that differs between rsi and rdi
+	 * within rcx bytes, or -1. Once every full vector matched, the last one is
+	 * compared again ending at rcx, as the bytes it shares with them are known to
+	 * be equal. There's no fast string instruction for this, so large sizes stay
+	 * with vectors.
+	 */
+	[[nodiscard]] Error CompileCompare(const Parser::CompareStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr uint8_t JB = 0x72;
+		constexpr uint8_t JBE = 0x76;
+		constexpr uint8_t JE = 0x74;
+		constexpr uint8_t JNE = 0x75;
+		const RegisterSet saved = BLOCK_USED & live & ~RegisterBit(statement.dest);
+		
+		std::vector<std::pair<Register, Register>> moves{{Register::rsi, statement.a}, {Register::rdi, statement.b}};
+		std::optional<int64_t> count;
+		Error _error = (GetBlockCount(*statement.count, moves, count));
+		if (_error)return _error;
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileBlockOperands(moves, code);
+		if (count.has_value()) Gen::EmitMov(Register::rcx, *count, code);
+		
+		const auto compileVector = [&](std::vector<std::pair<size_t, uint8_t>> &foundJumps) {
+			Gen::EmitMovdquLoad(0, Register::rsi, 0, code);
+			Gen::EmitMovdquLoad(1, Register::rdi, 0, code);
+			Gen::EmitPcmpeqb(0, 1, code);
+			Gen::EmitPmovmskb(Register::rax, 0, code);
+			Gen::EmitXor(Register::rax, 0xFFFF, code);
+			foundJumps.emplace_back(code.length(), JNE);
+			Gen::EmitNop(6, code);
+		};
+		
+		const auto compileClass = [&](const BlockSize size) {
+			std::vector<std::pair<size_t, uint8_t>> foundJumps;
+			Gen::EmitXor(Register::rdx, Register::rdx, code);
+			
+			if (size == BlockSize::Bytes) {
+				Gen::EmitTest(Register::rcx, Register::rcx, code);
+				const size_t emptyJumpPtr = code.length();
+				Gen::EmitNop(6, code);
+				const size_t loopPtr = code.length();
+				Gen::EmitMovzxByteLoad(Register::rax, Register::rsi, 0, code);
+				Gen::EmitCmpByteLoad(Register::rax, Register::rdi, 0, code);
+				foundJumps.emplace_back(code.length(), JNE);
+				Gen::EmitNop(6, code);
+				Gen::EmitAdd(Register::rsi, 1, code);
+				Gen::EmitAdd(Register::rdi, 1, code);
+				Gen::EmitAdd(Register::rdx, 1, code);
+				bool inverted = false;
+				Gen::EmitCmp(Register::rdx, Register::rcx, code, inverted);
+				const size_t loopJumpPtr = code.length();
+				Gen::EmitNop(6, code);
+				Gen::WriteJump(loopJumpPtr, loopPtr, JB, code);
+				Gen::WriteJump(emptyJumpPtr, code.length(), JE, code);
+				CompileBlockIndex(foundJumps, false, code);
+				return;
+			}
+			
+			const size_t loopPtr = code.length();
+			compileVector(foundJumps);
+			Gen::EmitAdd(Register::rsi, 16, code);
+			Gen::EmitAdd(Register::rdi, 16, code);
+			Gen::EmitAdd(Register::rdx, 16, code);
+			Gen::EmitLea(Register::rax, Register::rdx, 16, code);
+			bool inverted = false;
+			Gen::EmitCmp(Register::rax, Register::rcx, code, inverted);
+			const size_t loopJumpPtr = code.length();
+			Gen::EmitNop(6, code);
+			Gen::WriteJump(loopJumpPtr, loopPtr, JBE, code);
+			
+			Gen::EmitCmp(Register::rdx, Register::rcx, code, inverted);
+			const size_t doneJumpPtr = code.length();
+			Gen::EmitNop(6, code);
+			Gen::EmitMov(Register::rax, Register::rcx, code);
+			Gen::EmitSub(Register::rax, Register::rdx, code);
+			Gen::EmitSub(Register::rax, 16, code);
+			Gen::EmitAdd(Register::rsi, Register::rax, code);
+			Gen::EmitAdd(Register::rdi, Register::rax, code);
+			Gen::EmitAdd(Register::rdx, Register::rax, code);
+			compileVector(foundJumps);
+			Gen::WriteJump(doneJumpPtr, code.length(), JE, code);
+			CompileBlockIndex(foundJumps, true, code);
+		};
+		CompileBlockClasses(count, false, false, compileClass, code);
+		
+		if (statement.dest != Register::rax) Gen::EmitMov(statement.dest, Register::rax, code);
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	// Finds the index of the first byte equal to the low byte of rdi within rcx bytes at rsi, or -1.
+	[[nodiscard]] Error CompileFind(const Parser::FindStatement &statement, const RegisterSet live, MachineCode &code) {
+		constexpr uint8_t JB = 0x72;
+		constexpr uint8_t JBE = 0x76;
+		constexpr uint8_t JE = 0x74;
+		constexpr uint8_t JNE = 0x75;
+		constexpr int64_t BYTE_PATTERN = 0x0101010101010101;
+		const RegisterSet saved = BLOCK_USED & live & ~RegisterBit(statement.dest);
+		
+		std::vector<std::pair<Register, Register>> moves{{Register::rsi, statement.address}};
+		std::optional<int64_t> count;
+		Error _error = (GetBlockCount(*statement.count, moves, count));
+		if (_error)return _error;
+		
+		std::optional<int64_t> value;
+		switch (statement.value->tag) {
+			case OperandTag::Register: moves.emplace_back(Register::rdi, dynamic_cast<const RegisterOperand &>(*statement.value).reg);
+				break;
+			case OperandTag::Immediate: value = dynamic_cast<const ImmediateOperand &>(*statement.value).value & 0xFF;
+				break;
+			default: return Error{"Unsopported source argument type.", statement.pos};
+		}
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileBlockOperands(moves, code);
+		if (count.has_value()) Gen::EmitMov(Register::rcx, *count, code);
+		if (value.has_value()) Gen::EmitMov(Register::rdi, *value, code);
+		else Gen::EmitAnd(Register::rdi, 0xFF, code);
+		
+		const auto compileVector = [&](std::vector<std::pair<size_t, uint8_t>> &foundJumps) {
+			Gen::EmitMovdquLoad(0, Register::rsi, 0, code);
+			Gen::EmitPcmpeqb(0, 1, code);
+			Gen::EmitPmovmskb(Register::rax, 0, code);
+			Gen::EmitTest(Register::rax, Register::rax, code);
+			foundJumps.emplace_back(code.length(), JNE);
+			Gen::EmitNop(6, code);
+		};
+		
+		const auto compileClass = [&](const BlockSize size) {
+			std::vector<std::pair<size_t, uint8_t>> foundJumps;
+			Gen::EmitXor(Register::rdx, Register::rdx, code);
+			
+			if (size == BlockSize::Bytes) {
+				Gen::EmitTest(Register::rcx, Register::rcx, code);
+				const size_t emptyJumpPtr = code.length();
+				Gen::EmitNop(6, code);
+				const size_t loopPtr = code.length();
+				Gen::EmitMovzxByteLoad(Register::rax, Register::rsi, 0, code);
+				bool inverted = false;
+				Gen::EmitCmp(Register::rax, Register::rdi, code, inverted);
+				foundJumps.emplace_back(code.length(), JE);
+				Gen::EmitNop(6, code);
+				Gen::EmitAdd(Register::rsi, 1, code);
+				Gen::EmitAdd(Register::rdx, 1, code);
+				Gen::EmitCmp(Register::rdx, Register::rcx, code, inverted);
+				const size_t loopJumpPtr = code.length();
+				Gen::EmitNop(6, code);
+				Gen::WriteJump(loopJumpPtr, loopPtr, JB, code);
+				Gen::WriteJump(emptyJumpPtr, code.length(), JE, code);
+				CompileBlockIndex(foundJumps, false, code);
+				return;
+			}
+			
+			Gen::EmitImul(Register::rax, Register::rdi, BYTE_PATTERN, code);
+			Gen::EmitMovq(1, Register::rax, code);
+			Gen::EmitPunpcklqdq(1, 1, code);
+			
+			const size_t loopPtr = code.length();
+			compileVector(foundJumps);
+			Gen::EmitAdd(Register::rsi, 16, code);
+			Gen::EmitAdd(Register::rdx, 16, code);
+			Gen::EmitLea(Register::rax, Register::rdx, 16, code);
+			bool inverted = false;
+			Gen::EmitCmp(Register::rax, Register::rcx, code, inverted);
+			const size_t loopJumpPtr = code.length();
+			Gen::EmitNop(6, code);
+			Gen::WriteJump(loopJumpPtr, loopPtr, JBE, code);
+			
+			Gen::EmitCmp(Register::rdx, Register::rcx, code, inverted);
+			const size_t doneJumpPtr = code.length();
+			Gen::EmitNop(6, code);
+			Gen::EmitMov(Register::rax, Register::rcx, code);
+			Gen::EmitSub(Register::rax, Register::rdx, code);
+			Gen::EmitSub(Register::rax, 16, code);
+			Gen::EmitAdd(Register::rsi, Register::rax, code);
+			Gen::EmitAdd(Register::rdx, Register::rax, code);
+			compileVector(foundJumps);
+			Gen::WriteJump(doneJumpPtr, code.length(), JE, code);
+			CompileBlockIndex(foundJumps, true, code);
+		};
+		CompileBlockClasses(count, false, false, compileClass, code);
+		
+		if (statement.dest != Register::rax) Gen::EmitMov(statement.dest, Register::rax, code);
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	/* NOTE Reads the timestamp counter into dest. rdtsc is fenced on both sides,
+	 * so it neither starts before earlier instructions finish nor lets later
+	 * ones start before it. rdtscp already waits for earlier instructions and
+	 * also gives the processor's TSC_AUX value, which tells whether two readings
+	 * came from the same core.
+	 */
+	void CompileTimestamp(const Register dest, const std::optional<Register> processor, const RegisterSet live, MachineCode &code) {
+		RegisterSet used = RegisterBit(Register::rax) | RegisterBit(Register::rdx);
+		if (processor.has_value()) used |= RegisterBit(Register::rcx);
+		RegisterSet saved = used & live & ~RegisterBit(dest);
+		if (processor.has_value()) saved &= ~RegisterBit(*processor);
+		
+		Gen::EmitPushRegs(saved, code);
+		if (processor.has_value()) {
+			Gen::EmitRdtscp(code);
+		}
+		else {
+			Gen::EmitLfence(code);
+			Gen::EmitRdtsc(code);
+		}
+		Gen::EmitLfence(code);
+		Gen::EmitShl(Register::rdx, 32, code);
+		Gen::EmitOr(Register::rax, Register::rdx, code);
+		
+		// The counter is in rax and TSC_AUX in rcx, either of which may be the other's destination.
+		if (!processor.has_value()) {
+			if (dest != Register::rax) Gen::EmitMov(dest, Register::rax, code);
+		}
+		else if (dest == Register::rcx && *processor == Register::rax) {
+			Gen::EmitXchg(Register::rax, Register::rcx, code);
+		}
+		else if (dest == Register::rcx) {
+			Gen::EmitMov(*processor, Register::rcx, code);
+			Gen::EmitMov(Register::rcx, Register::rax, code);
+		}
+		else {
+			if (dest != Register::rax) Gen::EmitMov(dest, Register::rax, code);
+			if (*processor != Register::rcx) Gen::EmitMov(*processor, Register::rcx, code);
+		}
+		
+		Gen::EmitPopRegs(saved, code);
+	}
+	
+	/* NOTE Calls the runtime's table functions with the table in rdi, the key
+	 * in rsi and the value in rdx. Only caller-saved registers that are still
+	 * live get saved around the call.
+	 */
+	[[nodiscard]] Error CompileTableCall(const Parser::TableStatement &statement, const RegisterSet live, MachineCode &code) {
+		if (Options::flag_freestanding) return Error{"Hash tables are not supported in freestanding mode.", statement.pos};
+		
+		int64_t addr;
+		switch (statement.tag) {
+			case StatementTag::Insert: {
+				void (*fn)(HashTable *, int64_t, int64_t) = &TableInsert;
+				memcpy(&addr, &fn, 8);
+				break;
+			}
+			case StatementTag::Lookup: {
+				int64_t (*fn)(HashTable *, int64_t) = &TableLookup;
+				memcpy(&addr, &fn, 8);
+				break;
+			}
+			default: {
+				int64_t (*fn)(HashTable *, int64_t, int64_t) = &TableIncrement;
+				memcpy(&addr, &fn, 8);
+				break;
+			}
+		}
+		
+		const bool hasResult = statement.tag != StatementTag::Insert;
+		const RegisterSet saved = CALLER_SAVED & live & ~(hasResult ? RegisterBit(statement.dest) : 0);
+		
+		std::vector<std::pair<Register, Register>> moves{{Register::rdi, statement.table}};
+		std::vector<std::pair<Register, int64_t>> immediates;
+		const auto addArgument = [&](const Register target, const Operand &operand) -> Error {
+			switch (operand.tag) {
+				case OperandTag::Register: moves.emplace_back(target, dynamic_cast<const RegisterOperand &>(operand).reg);
+					return Error::None;
+				case OperandTag::Immediate: immediates.emplace_back(target, dynamic_cast<const ImmediateOperand &>(operand).value);
+					return Error::None;
+				default: return Error{"Unsopported source argument type.", operand.pos};
+			}
+		};
+		Error _error = (addArgument(Register::rsi, *statement.key));
+		if (_error)return _error;
+		if (statement.value) {
+			_error = (addArgument(Register::rdx, *statement.value));
+			if (_error)return _error;
+		}
+		
+		Gen::EmitPushRegs(saved, code);
+		CompileBlockOperands(moves, code);
+		for (const auto &[target, value]: immediates) Gen::EmitMov(target, value, code);
+		Gen::EmitAlignedCall(addr, code);
+		if (hasResult && statement.dest != Register::rax) Gen::EmitMov(statement.dest, Register::rax, code);
+		Gen::EmitPopRegs(saved, code);
+		return Error::None;
+	}
+	
+	/* NOTE Shared routines called from the generated code. They are placed at the
+	 * start of the machine code, so their addresses are known before any
+	 * procedure is compiled.
+	 */
+	void CompileRuntimeStubs(MachineCode &code) {
+		if (Options::flag_freestanding) {
+			flushStubPtr = code.length();
+			CompileFreestandingFlush(code);
+			writeStubPtr = code.length();
+			CompileFreestandingWrite(code);
+			mapFileStubPtr = code.length();
+			CompileFreestandingMapFile(code);
+			growArenaStubPtr = code.length();
+			CompileFreestandingGrowArena(code);
+			return;
+		}
+		
+		flushStubPtr = code.length();
+		Gen::EmitPushRegs(CALLER_SAVED, code);
+		
+		void (*extendFn)() = &ExtendOutput;
+		int64_t addr;
+		memcpy(&addr, &extendFn, 8);
+		Gen::EmitAlignedCall(addr, code);
+		
+		Gen::EmitPopRegs(CALLER_SAVED, code);
+		Gen::EmitReturn(code);
+		
+		// Writes rcx bytes at rsi.
+		writeStubPtr = code.length();
+		Gen::EmitPushRegs(CALLER_SAVED, code);
+		
+		void (*printFn)(const char *, size_t) = &Print;
+		memcpy(&addr, &printFn, 8);
+		Gen::EmitMov(Register::rdi, Register::rsi, code);
+		Gen::EmitMov(Register::rsi, Register::rcx, code);
+		Gen::EmitAlignedCall(addr, code);
+		
+		Gen::EmitPopRegs(CALLER_SAVED, code);
+		Gen::EmitReturn(code);
+		
+		// Commits the arena up to rdi.
+		growArenaStubPtr = code.length();
+		Gen::EmitPushRegs(CALLER_SAVED, code);
+		
+		void (*growFn)(unsigned char *) = &GrowArena;
+		memcpy(&addr, &growFn, 8);
+		Gen::EmitAlignedCall(addr, code);
+		
+		Gen::EmitPopRegs(CALLER_SAVED, code);
+		Gen::EmitReturn(code);
+	}
+	
+	constexpr RegisterSet FREESTANDING_STUB_USED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rdx)
+	                                               | RegisterBit(Register::rsi) | RegisterBit(Register::rdi) | RegisterBit(Register::r8)
+	                                               | RegisterBit(Register::r11);
+	
+	/* NOTE Writes the module's output buffer with write(2) and empties it.
+	 * Preserves every register.
+	 */
+	void CompileFreestandingFlush(MachineCode &code) {
+		const auto cursorOffset = static_cast<int32_t>(offsetof(OutputBuffer, cursor));
+		const auto beginOffset = static_cast<int32_t>(offsetof(OutputBuffer, begin));
+		
+		Gen::EmitPushRegs(FREESTANDING_STUB_USED, code);
+		CompileOutputDescriptor(Register::r8, code);
+		Gen::EmitMovLoad(Register::rsi, Register::r8, beginOffset, code);
+		Gen::EmitMovLoad(Register::rdx, Register::r8, cursorOffset, code);
+		Gen::EmitSub(Register::rdx, Register::rsi, code);
+		CompileWriteLoop(code);
+		
+		Gen::EmitMovLoad(Register::rsi, Register::r8, beginOffset, code);
+		Gen::EmitMovStore(Register::r8, cursorOffset, Register::rsi, code);
+		Gen::EmitPopRegs(FREESTANDING_STUB_USED, code);
+		Gen::EmitReturn(code);
+	}
+	
+	/* NOTE Writes rcx bytes at rsi after flushing the buffer. Blocks that still
+	 * don't fit in the empty buffer skip it and go straight to write(2).
+	 * Preserves every register.
+	 */
+	void CompileFreestandingWrite(MachineCode &code) {
+		constexpr uint8_t JA = 0x77;
+		
+		const auto cursorOffset = static_cast<int32_t>(offsetof(OutputBuffer, cursor));
+		const auto endOffset = static_cast<int32_t>(offsetof(OutputBuffer, end));
+		bool inverted = false;
+		
+		Gen::EmitPushRegs(FREESTANDING_STUB_USED, code);
+		const size_t flushCallPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteCall(flushCallPtr, flushStubPtr, code);
+		
+		CompileOutputDescriptor(Register::r8, code);
+		Gen::EmitMovLoad(Register::rdi, Register::r8, cursorOffset, code);
+		Gen::EmitMovLoad(Register::rdx, Register::r8, endOffset, code);
+		Gen::EmitSub(Register::rdx, Register::rdi, code);
+		Gen::EmitCmp(Register::rcx, Register::rdx, code, inverted);
+		const size_t directJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitRepMovsb(code);
+		Gen::EmitMovStore(Register::r8, cursorOffset, Register::rdi, code);
+		const size_t doneJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		
+		Gen::WriteJump(directJumpPtr, code.length(), JA, code);
+		Gen::EmitMov(Register::rdx, Register::rcx, code);
+		CompileWriteLoop(code);
+		
+		Gen::WriteJump(doneJumpPtr, code.length(), code);
+		Gen::EmitPopRegs(FREESTANDING_STUB_USED, code);
+		Gen::EmitReturn(code);
+	}
+	
+	/* NOTE Writes rdx bytes at rsi to the descriptor in r8. Partial writes are
+	 * continued and EINTR is retried. Any other error is stored in the
+	 * descriptor for the runtime to report and the rest of the data is dropped.
+	 * Clobbers rax, rcx, rdx, rsi, rdi and r11.
+	 */
+	void CompileWriteLoop(MachineCode &code) {
+		constexpr uint8_t JE = 0x74;
+		constexpr uint8_t JS = 0x78;
+		constexpr int64_t SYS_WRITE = 1;
+		constexpr int64_t EINTR_RESULT = -4;
+		
+		const auto fdOffset = static_cast<int32_t>(offsetof(OutputBuffer, fd));
+		const auto errorOffset = static_cast<int32_t>(offsetof(OutputBuffer, error));
+		bool inverted = false;
+		
+		// syscall only clobbers rax, rcx and r11, the rest survives between iterations.
+		const size_t loopPtr = code.length();
+		Gen::EmitTest(Register::rdx, Register::rdx, code);
+		const size_t doneJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMov(Register::rax, SYS_WRITE, code);
+		Gen::EmitMovdLoad(Register::rdi, Register::r8, fdOffset, code);
+		Gen::EmitSyscall(code);
+		Gen::EmitTest(Register::rax, Register::rax, code);
+		const size_t errorJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitAdd(Register::rsi, Register::rax, code);
+		Gen::EmitSub(Register::rdx, Register::rax, code);
+		const size_t loopJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteJump(loopJumpPtr, loopPtr, code);
+		
+		Gen::WriteJump(errorJumpPtr, code.length(), JS, code);
+		Gen::EmitCmp(Register::rax, EINTR_RESULT, code, inverted);
+		const size_t retryJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::WriteJump(retryJumpPtr, loopPtr, JE, code);
+		Gen::EmitNeg(Register::rax, code);
+		Gen::EmitMovdStore(Register::r8, errorOffset, Register::rax, code);
+		
+		Gen::WriteJump(doneJumpPtr, code.length(), Comparison::LessEquals, false, code);
+	}
+	
+	/* NOTE Maps the file whose NUL terminated path is in rdi with open, lseek
+	 * and mmap system calls. Returns the address in rax and the length in rdx,
+	 * like MapFile. Failures give a length of -1. Preserves every other register.
+	 */
+	void CompileFreestandingMapFile(MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rcx) | RegisterBit(Register::rsi) | RegisterBit(Register::rdi) | RegisterBit(Register::r8)
+		                             | RegisterBit(Register::r9) | RegisterBit(Register::r10) | RegisterBit(Register::r11);
+		constexpr uint8_t JA = 0x77;
+		constexpr uint8_t JE = 0x74;
+		constexpr uint8_t JS = 0x78;
+		constexpr int64_t SYS_OPEN = 2;
+		constexpr int64_t SYS_CLOSE = 3;
+		constexpr int64_t SYS_LSEEK = 8;
+		constexpr int64_t SYS_MMAP = 9;
+		constexpr int64_t SYS_MADVISE = 28;
+		constexpr int64_t OPEN_FLAGS = O_RDONLY | O_CLOEXEC;
+		constexpr int64_t MMAP_FLAGS = MAP_PRIVATE | MAP_POPULATE;
+		constexpr int64_t MADVISE_HUGEPAGE = 14;
+		constexpr int64_t MAX_ERRNO = 4095;
+		bool inverted = false;
+		
+		Gen::EmitPushRegs(USED, code);
+		
+		Gen::EmitMov(Register::rsi, OPEN_FLAGS, code);
+		Gen::EmitMov(Register::rax, SYS_OPEN, code);
+		Gen::EmitSyscall(code);
+		Gen::EmitTest(Register::rax, Register::rax, code);
+		const size_t openFailedJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMov(Register::r8, Register::rax, code);
+		
+		// The length stays in rsi, syscall doesn't touch it.
+		Gen::EmitMov(Register::rdi, Register::r8, code);
+		Gen::EmitMov(Register::rsi, INT64_C(0), code);
+		Gen::EmitMov(Register::rdx, SEEK_END, code);
+		Gen::EmitMov(Register::rax, SYS_LSEEK, code);
+		Gen::EmitSyscall(code);
+		Gen::EmitTest(Register::rax, Register::rax, code);
+		const size_t seekFailedJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMov(Register::rsi, Register::rax, code);
+		Gen::EmitMov(Register::r9, INT64_C(0), code);
+		const size_t emptyJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		
+		Gen::EmitMov(Register::rdi, INT64_C(0), code);
+		Gen::EmitMov(Register::rdx, PROT_READ, code);
+		Gen::EmitMov(Register::r10, MMAP_FLAGS, code);
+		Gen::EmitMov(Register::rax, SYS_MMAP, code);
+		Gen::EmitSyscall(code);
+		Gen::EmitCmp(Register::rax, -MAX_ERRNO - 1, code, inverted);
+		const size_t mapFailedJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitMov(Register::r9, Register::rax, code);
+		Gen::EmitMov(Register::rdi, Register::rax, code);
+		Gen::EmitMov(Register::rdx, MADVISE_HUGEPAGE, code);
+		Gen::EmitMov(Register::rax, SYS_MADVISE, code);
+		Gen::EmitSyscall(code);
+		const size_t closeJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		
+		Gen::WriteJump(seekFailedJumpPtr, code.length(), JS, code);
+		Gen::WriteJump(mapFailedJumpPtr, code.length(), JA, code);
+		Gen::EmitMov(Register::r9, INT64_C(0), code);
+		Gen::EmitMov(Register::rsi, INT64_C(-1), code);
+		
+		Gen::WriteJump(closeJumpPtr, code.length(), code);
+		Gen::WriteJump(emptyJumpPtr, code.length(), JE, code);
+		Gen::EmitMov(Register::rdi, Register::r8, code);
+		Gen::EmitMov(Register::rax, SYS_CLOSE, code);
+		Gen::EmitSyscall(code);
+		Gen::EmitMov(Register::rax, Register::r9, code);
+		Gen::EmitMov(Register::rdx, Register::rsi, code);
+		const size_t doneJumpPtr = code.length();
+		Gen::EmitNop(5, code);
+		
+		Gen::WriteJump(openFailedJumpPtr, code.length(), JS, code);
+		Gen::EmitMov(Register::rax, INT64_C(0), code);
+		Gen::EmitMov(Register::rdx, INT64_C(-1), code);
+		
+		Gen::WriteJump(doneJumpPtr, code.length(), code);
+		Gen::EmitPopRegs(USED, code);
+		Gen::EmitReturn(code);
+	}
+	
+	/* NOTE Commits the module's arena up to the address in rdi with mprotect.
+	 * Running out of arena writes a message to stderr and ends the process, as
+	 * GrowArena does, after writing out the buffered output. Preserves every
+	 * register.
+	 */
+	void CompileFreestandingGrowArena(MachineCode &code) {
+		constexpr RegisterSet USED = RegisterBit(Register::rax) | RegisterBit(Register::rcx) | RegisterBit(Register::rdx) | RegisterBit(Register::rsi)
+		                             | RegisterBit(Register::rdi) | RegisterBit(Register::r8) | RegisterBit(Register::r11);
+		constexpr uint8_t JA = 0x77;
+		constexpr uint8_t JB = 0x72;
+		constexpr uint8_t JNE = 0x75;
+		constexpr int64_t SYS_WRITE = 1;
+		constexpr int64_t SYS_MPROTECT = 10;
+		constexpr int64_t SYS_EXIT_GROUP = 231;
+		const std::string message = "Arena is out of space, see --arena-size\n";
+		
+		const auto cursorOffset = static_cast<int32_t>(offsetof(Arena, cursor));
+		const auto endOffset = static_cast<int32_t>(offsetof(Arena, end));
+		const auto beginOffset = static_cast<int32_t>(offsetof(Arena, begin));
+		const auto limitOffset = static_cast<int32_t>(offsetof(Arena, limit));
+		
+		Gen::EmitPushRegs(USED, code);
+		CompileArenaDescriptor(Register::r8, code);
+		Gen::EmitCmpLoad(Register::rdi, Register::r8, cursorOffset, code);
+		const size_t wrappedJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitCmpLoad(Register::rdi, Register::r8, limitOffset, code);
+		const size_t fullJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		
+		// rsi = begin + (rdi - begin) rounded up to a chunk, the limit is a multiple of it.
+		Gen::EmitMovLoad(Register::rdx, Register::r8, beginOffset, code);
+		Gen::EmitMov(Register::rsi, Register::rdi, code);
+		Gen::EmitSub(Register::rsi, Register::rdx, code);
+		Gen::EmitAdd(Register::rsi, static_cast<int64_t>(ARENA_CHUNK - 1), code);
+		Gen::EmitAnd(Register::rsi, -static_cast<int64_t>(ARENA_CHUNK), code);
+		Gen::EmitAdd(Register::rsi, Register::rdx, code);
+		Gen::EmitMovLoad(Register::rdi, Register::r8, endOffset, code);
+		Gen::EmitMovStore(Register::r8, endOffset, Register::rsi, code);
+		Gen::EmitSub(Register::rsi, Register::rdi, code);
+		Gen::EmitMov(Register::rdx, PROT_READ | PROT_WRITE, code);
+		Gen::EmitMov(Register::rax, SYS_MPROTECT, code);
+		Gen::EmitSyscall(code);
+		Gen::EmitTest(Register::rax, Register::rax, code);
+		const size_t failedJumpPtr = code.length();
+		Gen::EmitNop(6, code);
+		Gen::EmitPopRegs(USED, code);
+		Gen::EmitReturn(code);
+		
+		Gen::WriteJump(wrappedJumpPtr, code.length(), JB, code);
+		Gen::WriteJump(fullJumpPtr, code.length(), JA, code);
+		Gen::WriteJump(failedJumpPtr, code.length(), JNE, code);
+		const size_t flushCallPtr = code.length();
+		Gen::EmitNop(5, code);
+		Gen::WriteCall(flushCallPtr, flushStubPtr, code);
+		Gen::EmitMov(Register::rax, SYS_WRITE, code);
+		Gen::EmitMov(Register::rdi, STDERR_FILENO, code);
+		Gen::EmitLeaData(Register::rsi, Section::ReadOnly, AddString(message), code);
+		Gen::EmitMov(Register::rdx, static_cast<int64_t>(message.length()), code);
+		Gen::EmitSyscall(code);
+		Gen::EmitMov(Register::rax, SYS_EXIT_GROUP, code);
+		Gen::EmitMov(Register::rdi, 1, code);
+		Gen::EmitSyscall(code);
+	}
+	
+	// Address of the arena descriptor, inside the module when freestanding.
+	void CompileArenaDescriptor(const Register dest, MachineCode &code) {
+		if (Options::flag_freestanding) {
+			Gen::EmitLeaData(dest, Section::Writable, ARENA_DESCRIPTOR_PTR, code);
+			return;
+		}
+		
+		Arena *descriptor = &arena;
+		int64_t addr;
+		memcpy(&addr, &descriptor, 8);
+		Gen::EmitMov(dest, addr, code);
+	}
+	
+	// Address of the output descriptor, inside the module when freestanding.
+	void CompileOutputDescriptor(const Register dest, MachineCode &code) {
+		if (Options::flag_freestanding) {
+			Gen::EmitLeaData(dest, Section::Writable, OUTPUT_DESCRIPTOR_PTR, code);
+			return;
+		}
+		
+		OutputBuffer *buffer = &output;
+		int64_t addr;
+		memcpy(&addr, &buffer, 8);
+		Gen::EmitMov(dest, addr, code);
+	}
+}
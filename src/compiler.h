@@ -3,6 +3,7 @@
 #include "types.h"
 #include "error.h"
 #include "parser.h"
+#include "ir.h"
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -16,12 +17,43 @@ namespace Compiler {
 	using MachineCode = std::basic_string<unsigned char>;
 	using Statements = std::vector<std::unique_ptr<Parser::Statement>>;
 	
+	// What the peephole pass did to one procedure, skipped if it couldn't decode the code.
+	struct PeepholeStats {
+		std::string procedure;
+		size_t instructions;
+		size_t removedInstructions;
+		size_t bytes;
+		size_t removedBytes;
+		size_t shortBranches;
+		bool skipped;
+	};
+	
 	[[nodiscard]] Runtime::Error Compile(
 			std::unordered_map<std::string, std::vector<std::unique_ptr<Parser::Statement>>> &procedures,
-			std::basic_string<unsigned char> &code, size_t &entry);
+			const std::unordered_map<std::string, IR::Procedure> &ir, std::basic_string<unsigned char> &code, size_t &entry, size_t &rodataPtr, size_t &dataPtr,
+			std::vector<PeepholeStats> &peephole);
+	
+	constexpr size_t MODULE_PAGE_SIZE = 4096;
+	
+	// Loop heads start a fetch block of their own, the code is mapped at a page boundary.
+	constexpr size_t LOOP_ALIGNMENT = 32;
+	
+	// Data sections appended to the machine code, each starting on its own page.
+	enum class Section : uint8_t {
+		ReadOnly,
+		Writable,
+	};
+	
+	// A RIP-relative displacement at from, patched to point offset bytes into a section.
+	struct SectionRef {
+		size_t from;
+		Section section;
+		size_t offset;
+	};
 	
-	static std::unordered_set<std::size_t> loopBreaks;
-	static std::unordered_set<std::size_t> loopContinues;
+	// In freestanding mode the runtime descriptors are at the start of the writable section.
+	constexpr size_t OUTPUT_DESCRIPTOR_PTR = 0;
+	constexpr size_t ARENA_DESCRIPTOR_PTR = 32;
 	
 	namespace Gen {
 		
@@ -29,6 +61,8 @@ namespace Compiler {
 		
 		void EmitRexB(MachineCode &code);
 		
+		void EmitRex(bool w, bool r, bool x, bool b, MachineCode &code);
+		
 		void EmitModRM(uint8_t mod, uint8_t reg, uint8_t rm, MachineCode &code);
 		
 		void EmitSIB(uint8_t scale, uint8_t index, uint8_t base, MachineCode &code);
@@ -43,16 +77,46 @@ namespace Compiler {
 		
 		void EmitPopAllRegs(MachineCode &code);
 		
+		void EmitPushRegs(RegisterSet regs, MachineCode &code);
+		
+		void EmitPopRegs(RegisterSet regs, MachineCode &code);
+		
 		void EmitMov(Register dest, Register source, MachineCode &code);
 		
 		void EmitMov(Register dest, int64_t value, MachineCode &code);
 		
 		void EmitLea(Register dest, size_t to, MachineCode &code);
 		
+		void EmitRipOperand(uint8_t reg, Section section, size_t dataPtr, MachineCode &code);
+		
+		void EmitLeaData(Register dest, Section section, size_t dataPtr, MachineCode &code);
+		
 		void EmitMovStack(Register dest, int64_t stackOffset, MachineCode &code);
 		
 		void EmitMovStack(int64_t stackOffset, Register source, MachineCode &code);
 		
+		void EmitLeaStack(Register dest, int64_t stackOffset, MachineCode &code);
+		
+		void EmitMemOperand(uint8_t reg, Register base, int32_t disp, MachineCode &code);
+		
+		void EmitMovLoad(Register dest, Register base, int32_t disp, MachineCode &code);
+		
+		void EmitMovStore(Register base, int32_t disp, Register source, MachineCode &code);
+		
+		void EmitLea(Register dest, Register base, int32_t disp, MachineCode &code);
+		
+		void EmitMovzxWordLoad(Register dest, Register base, Register index, uint8_t scale, MachineCode &code);
+		
+		void EmitMovWordStore(Register base, int32_t disp, Register source, MachineCode &code);
+		
+		void EmitMovByteStore(Register base, int32_t disp, Register source, MachineCode &code);
+		
+		void EmitMovByteStore(Register base, int32_t disp, int8_t value, MachineCode &code);
+		
+		void EmitMovdquLoad(uint8_t dest, Register base, int32_t disp, MachineCode &code);
+		
+		void EmitMovdquStore(Register base, int32_t disp, uint8_t source, MachineCode &code);
+		
 		void EmitAdd(Register dest, Register source, MachineCode &code);
 		
 		void EmitAdd(Register dest, int64_t value, MachineCode &code);
@@ -79,27 +143,59 @@ namespace Compiler {
 		
 		void EmitIdiv(Register divisor, MachineCode &code);
 		
+		void EmitMul(Register source, MachineCode &code);
+		
+		void EmitNeg(Register dest, MachineCode &code);
+		
+		void EmitShr(Register dest, uint8_t count, MachineCode &code);
+		
+		void EmitTest(Register a, Register b, MachineCode &code);
+		
 		void EmitCmp(Register a, Register b, MachineCode &code, bool &inverted);
 		
 		void EmitCmp(Register a, int64_t b, MachineCode &code, bool &inverted);
 		
 		void EmitCmp(int64_t a, Register b, MachineCode &code, bool &inverted);
 		
+		void EmitCmpLoad(Register a, Register base, int32_t disp, MachineCode &code);
+		
+		void EmitRepMovsb(MachineCode &code);
+		
+		void EmitMovdLoad(Register dest, Register base, int32_t disp, MachineCode &code);
+		
+		void EmitMovdStore(Register base, int32_t disp, Register source, MachineCode &code);
+		
+		void EmitSyscall(MachineCode &code);
+		
+		void EmitXchg(Register a, Register b, MachineCode &code);
+		
 		void WriteJump(size_t from, size_t to, MachineCode &code);
 		
 		void WriteJump(size_t from, size_t to, Comparison comp, bool inverted, MachineCode &code);
 		
+		void WriteJump(size_t from, size_t to, uint8_t opcode, MachineCode &code);
+		
 		void EmitReturn(MachineCode &code);
 		
 		void EmitPush(Register reg, MachineCode &code);
 		
 		void EmitPop(Register reg, MachineCode &code);
 		
+		void EmitXchgRsp(Register reg, MachineCode &code);
+		
+		void EmitPopRsp(MachineCode &code);
+		
 		void EmitNop(size_t length, MachineCode &code);
 		
+		void EmitPadding(size_t length, MachineCode &code);
+		
 		void EmitCall(Register reg, MachineCode &code);
 		
+		void EmitAlignedCall(int64_t addr, MachineCode &code);
+		
 		void WriteCall(size_t from, size_t to, MachineCode &code);
 		
+		void WriteRipOffset(size_t from, size_t to, MachineCode &code);
+	
 	}
 };
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include "ir.h"
+
+namespace Compiler::IR {
+	
+	using Statements = std::vector<std::unique_ptr<Parser::Statement>>;
+	
+	// Where continue and break go
+	struct LoopTargets {
+		size_t next;
+		size_t exit;
+	};
+	
+	/* NOTE Blocks are created when they are first needed as a jump target, but
+	 * laid out in the order they are started, which follows the source. The
+	 * current block is always open and gets its terminator when control flow
+	 * leaves it.
+	 */
+	struct Builder {
+		Procedure &procedure;
+		std::vector<size_t> order;
+		size_t current;
+		std::vector<LoopTargets> loops;
+	};
+	
+	Value ValueOf(const Operand &operand) {
+		if (operand.tag == OperandTag::Register) return Value{OperandTag::Register, dynamic_cast<const RegisterOperand &>(operand).reg, 0};
+		return Value{OperandTag::Immediate, Register::rax, dynamic_cast<const ImmediateOperand &>(operand).value};
+	}
+	
+	void Normalize(Condition &condition) {
+		if (condition.a.tag != OperandTag::Immediate || condition.b.tag != OperandTag::Register) return;
+		
+		std::swap(condition.a, condition.b);
+		switch (condition.comp) {
+			case Comparison::LessThan: condition.comp = Comparison::GreaterThan;
+				break;
+			case Comparison::LessEquals: condition.comp = Comparison::GreaterEquals;
+				break;
+			case Comparison::GreaterThan: condition.comp = Comparison::LessThan;
+				break;
+			case Comparison::GreaterEquals: condition.comp = Comparison::LessEquals;
+				break;
+			default: break;
+		}
+	}
+	
+	Condition ConditionOf(const Compiler::Condition &condition) {
+		Condition result{ValueOf(*condition.a), ValueOf(*condition.b), condition.comp, condition.pos};
+		Normalize(result);
+		return result;
+	}
+	
+	size_t NewBlock(Builder &builder) {
+		builder.procedure.blocks.emplace_back();
+		return builder.procedure.blocks.size() - 1;
+	}
+	
+	void Start(Builder &builder, const size_t block) {
+		builder.current = block;
+		builder.order.push_back(block);
+	}
+	
+	void Terminate(Builder &builder, const Terminator terminator) {
+		builder.procedure.blocks[builder.current].terminator = terminator;
+	}
+	
+	void Jump(Builder &builder, const size_t target) {
+		Terminate(builder, Terminator{TerminatorTag::Jump, {}, target, 0});
+	}
+	
+	void Branch(Builder &builder, const Compiler::Condition &condition, const size_t target, const size_t otherwise) {
+		Terminate(builder, Terminator{TerminatorTag::Branch, ConditionOf(condition), target, otherwise});
+	}
+	
+	void Append(Builder &builder, const Instruction instruction) {
+		builder.procedure.blocks[builder.current].instructions.push_back(instruction);
+	}
+	
+	[[nodiscard]] Error Lower(Builder &builder, const Statements &statements);
+	
+	// Break, continue and return leave the block. With a condition they branch, otherwise whatever follows is unreachable.
+	void LowerExit(Builder &builder, const Parser::Statement &statement, const size_t target) {
+		const size_t after = NewBlock(builder);
+		if (statement.condition.has_value()) Branch(builder, *statement.condition, target, after);
+		else Jump(builder, target);
+		Start(builder, after);
+	}
+	
+	void LowerInstruction(Builder &builder, const Parser::Statement &statement) {
+		Instruction instruction{InstructionTag::Statement, Operation::Add, Register::rax, {}, {}, Register::rax, &statement};
+		switch (statement.tag) {
+			case StatementTag::Assignment: {
+				const auto &stmt = dynamic_cast<const Parser::AssignmentStatement &>(statement);
+				instruction.tag = InstructionTag::Move;
+				instruction.dest = stmt.dest;
+				instruction.a = ValueOf(*stmt.source);
+				break;
+			}
+			case StatementTag::Shorthand: {
+				const auto &stmt = dynamic_cast<const Parser::ShorthandStatement &>(statement);
+				instruction.tag = InstructionTag::Binary;
+				instruction.op = stmt.op;
+				instruction.dest = stmt.dest;
+				instruction.a = Value{OperandTag::Register, stmt.dest, 0};
+				instruction.b = ValueOf(*stmt.source);
+				break;
+			}
+			case StatementTag::Longhand: {
+				const auto &stmt = dynamic_cast<const Parser::LonghandStatement &>(statement);
+				instruction.tag = InstructionTag::Binary;
+				instruction.op = stmt.op;
+				instruction.dest = stmt.dest;
+				instruction.a = ValueOf(*stmt.sourceA);
+				instruction.b = ValueOf(*stmt.sourceB);
+				break;
+			}
+			case StatementTag::DivMod: {
+				const auto &stmt = dynamic_cast<const Parser::DivModStatement &>(statement);
+				instruction.tag = InstructionTag::DivMod;
+				instruction.dest = stmt.quotient;
+				instruction.remainder = stmt.remainder;
+				instruction.a = ValueOf(*stmt.dividend);
+				instruction.b = ValueOf(*stmt.divisor);
+				break;
+			}
+			default: break;
+		}
+		Append(builder, instruction);
+	}
+	
+	[[nodiscard]] Error LowerStatement(Builder &builder, const Parser::Statement &statement) {
+		switch (statement.tag) {
+			case StatementTag::Loop: {
+				const auto &stmt = dynamic_cast<const Parser::LoopStatement &>(statement);
+				const size_t body = NewBlock(builder);
+				builder.procedure.blocks[body].loopHead = true;
+				if (!stmt.condition.has_value()) {
+					const size_t exit = NewBlock(builder);
+					Jump(builder, body);
+					Start(builder, body);
+					
+					builder.loops.push_back(LoopTargets{body, exit});
+					Error _error = (Lower(builder, stmt.statements));
+					if (_error)return _error;
+					builder.loops.pop_back();
+					
+					Jump(builder, body);
+					Start(builder, exit);
+					return Error::None;
+				}
+				
+				// Continue goes to the test at the bottom, which falls through to the exit when the condition fails.
+				const size_t test = NewBlock(builder);
+				const size_t exit = NewBlock(builder);
+				Branch(builder, *stmt.condition, body, exit);
+				Start(builder, body);
+				
+				builder.loops.push_back(LoopTargets{test, exit});
+				Error _error = (Lower(builder, stmt.statements));
+				if (_error)return _error;
+				builder.loops.pop_back();
+				
+				Jump(builder, test);
+				Start(builder, test);
+				Branch(builder, *stmt.condition, body, exit);
+				Start(builder, exit);
+				return Error::None;
+			}
+			case StatementTag::Branch: {
+				const auto &stmt = dynamic_cast<const Parser::BranchStatement &>(statement);
+				const size_t then = NewBlock(builder);
+				const size_t otherwise = stmt.elseBlock.empty() ? 0 : NewBlock(builder);
+				const size_t after = NewBlock(builder);
+				Branch(builder, *stmt.condition, then, stmt.elseBlock.empty() ? after : otherwise);
+				
+				Start(builder, then);
+				Error _error = (Lower(builder, stmt.statements));
+				if (_error)return _error;
+				Jump(builder, after);
+				
+				if (!stmt.elseBlock.empty()) {
+					Start(builder, otherwise);
+					_error = (Lower(builder, stmt.elseBlock));
+					if (_error)return _error;
+					Jump(builder, after);
+				}
+				
+				Start(builder, after);
+				return Error::None;
+			}
+			case StatementTag::Break:
+			case StatementTag::Continue: {
+				if (builder.loops.empty()) return Error{"Break or continue statements in a procedure outside a loop.", statement.pos};
+				const LoopTargets &loop = builder.loops.back();
+				LowerExit(builder, statement, statement.tag == StatementTag::Break ? loop.exit : loop.next);
+				return Error::None;
+			}
+			case StatementTag::Return: {
+				const size_t after = NewBlock(builder);
+				if (!statement.condition.has_value()) {
+					Terminate(builder, Terminator{TerminatorTag::Return, {}, 0, 0});
+					Start(builder, after);
+					return Error::None;
+				}
+				
+				// The returning block goes right after the branch, so it doesn't need a jump of its own.
+				const size_t exit = NewBlock(builder);
+				Branch(builder, *statement.condition, exit, after);
+				Start(builder, exit);
+				Terminate(builder, Terminator{TerminatorTag::Return, {}, 0, 0});
+				Start(builder, after);
+				return Error::None;
+			}
+			default: break;
+		}
+		
+		if (!statement.condition.has_value()) {
+			LowerInstruction(builder, statement);
+			return Error::None;
+		}
+		
+		const size_t then = NewBlock(builder);
+		const size_t after = NewBlock(builder);
+		Branch(builder, *statement.condition, then, after);
+		Start(builder, then);
+		LowerInstruction(builder, statement);
+		Jump(builder, after);
+		Start(builder, after);
+		return Error::None;
+	}
+	
+	[[nodiscard]] Error Lower(Builder &builder, const Statements &statements) {
+		for (const auto &statement: statements) {
+			Error _error = (LowerStatement(builder, *statement));
+			if (_error)return _error;
+		}
+		return Error::None;
+	}
+	
+	[[nodiscard]] Error Build(const Statements &statements, Procedure &procedure) {
+		procedure.blocks.clear();
+		Builder builder{procedure, {}, 0, {}};
+		Start(builder, NewBlock(builder));
+		
+		Error _error = (Lower(builder, statements));
+		if (_error)return _error;
+		Terminate(builder, Terminator{TerminatorTag::Return, {}, 0, 0});
+		
+		// Put the blocks in layout order
+		std::vector<size_t> index(procedure.blocks.size());
+		for (size_t i = 0; i < builder.order.size(); ++i) index[builder.order[i]] = i;
+		
+		std::vector<Block> blocks;
+		blocks.reserve(builder.order.size());
+		for (const size_t block: builder.order) {
+			blocks.push_back(std::move(procedure.blocks[block]));
+			Terminator &terminator = blocks.back().terminator;
+			terminator.target = index[terminator.target];
+			terminator.otherwise = index[terminator.otherwise];
+		}
+		procedure.blocks = std::move(blocks);
+		return Error::None;
+	}
+	
+	[[nodiscard]] Error Build(const std::unordered_map<std::string, Statements> &procedures, std::unordered_map<std::string, Procedure> &ir) {
+		ir.clear();
+		for (const auto &[name, statements]: procedures) {
+			Error _error = (Build(statements, ir[name]));
+			if (_error)return _error;
+		}
+		return Error::None;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "types.h"
+#include "error.h"
+#include "parser.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Compiler::IR {
+	
+	/* NOTE The IR sits between the statement tree and the encoder. A procedure
+	 * is a list of basic blocks in layout order, the first one being the entry,
+	 * and every block ends in a terminator that names its successors by index.
+	 * Operands are the physical registers and immediates of the source.
+	 *
+	 * Loops with a condition are rotated: the condition is tested once before
+	 * the loop and again at the bottom, which branches back to the top, so an
+	 * iteration only takes one branch.
+	 *
+	 * Assignments and arithmetic are instructions of their own, so passes can
+	 * look into them. Every other statement is carried as an opaque instruction
+	 * and compiled the same way as before; its condition and any control flow
+	 * have been turned into blocks.
+	 */
+	struct Value {
+		OperandTag tag;
+		Register reg;
+		int64_t value;
+	};
+	
+	enum class InstructionTag : uint8_t {
+		Move,      // dest = a
+		Binary,    // dest = a op b, shorthand statements have dest as a
+		DivMod,    // dest, remainder = a divmod b
+		Statement, // compiled from statement
+	};
+	
+	struct Instruction {
+		InstructionTag tag;
+		Operation op;
+		Register dest;
+		Value a;
+		Value b;
+		Register remainder;                 // DivMod only
+		const Parser::Statement *statement; // The statement this came from, liveness is kept per statement
+		bool narrow = false;                // A division whose operands are known to fit in 32 unsigned bits
+	};
+	
+	// Registers come first, a condition with an immediate on the left is mirrored when it is built.
+	struct Condition {
+		Value a;
+		Value b;
+		Comparison comp;
+		CodePos pos;
+	};
+	
+	enum class TerminatorTag : uint8_t {
+		Jump,   // to target
+		Branch, // to target when the condition holds, to otherwise when it doesn't
+		Return,
+	};
+	
+	struct Terminator {
+		TerminatorTag tag;
+		Condition condition;
+		size_t target;
+		size_t otherwise;
+	};
+	
+	struct Block {
+		std::vector<Instruction> instructions;
+		Terminator terminator;
+		bool loopHead = false; // Where a loop jumps back to, aligned when the code is laid out
+	};
+	
+	struct Procedure {
+		std::vector<Block> blocks;
+	};
+	
+	Value ValueOf(const Operand &operand);
+	
+	// Puts the register first when an immediate is compared to a register.
+	void Normalize(Condition &condition);
+	
+	[[nodiscard]] Runtime::Error Build(const std::vector<std::unique_ptr<Parser::Statement>> &statements, Procedure &procedure);
+	
+	[[nodiscard]] Runtime::Error Build(const std::unordered_map<std::string, std::vector<std::unique_ptr<Parser::Statement>>> &procedures,
+	                                   std::unordered_map<std::string, Procedure> &ir);
+}
@@ -10,7 +10,7 @@ using namespace std::literals;
 
 namespace Lexer {
 	
-	constexpr size_t KEYWORD_COUNT = 44;
+	constexpr size_t KEYWORD_COUNT = 58;
 	
 	constexpr std::string_view KEYWORDS[KEYWORD_COUNT] = {
 			"rax"sv,
@@ -44,17 +44,31 @@ namespace Lexer {
 			"xmm13"sv,
 			"xmm14"sv,
 			"xmm15"sv,
+			"alloc"sv,
 			"branch"sv,
 			"break"sv,
+			"compare"sv,
 			"continue"sv,
+			"copy"sv,
+			"divmod"sv,
 			"else"sv,
+			"fill"sv,
+			"find"sv,
 			"if"sv,
+			"increment"sv,
+			"insert"sv,
+			"lookup"sv,
 			"loop"sv,
 			"macro"sv,
+			"mapfile"sv,
 			"pop"sv,
 			"proc"sv,
 			"push"sv,
+			"rdtsc"sv,
+			"rdtscp"sv,
+			"reset"sv,
 			"return"sv,
+			"table"sv,
 			"val"sv,
 			"var"sv,
 	};
@@ -47,17 +47,31 @@ namespace Lexer {
 		RegXmm14,
 		RegXmm15,
 		
+		KeyAlloc,
 		KeyBranch,
 		KeyBreak,
+		KeyCompare,
 		KeyContinue,
+		KeyCopy,
+		KeyDivmod,
 		KeyElse,
+		KeyFill,
+		KeyFind,
 		KeyIf,
+		KeyIncrement,
+		KeyInsert,
+		KeyLookup,
 		KeyLoop,
 		KeyMacro,
+		KeyMapfile,
 		KeyPop,
 		KeyProc,
 		KeyPush,
+		KeyRdtsc,
+		KeyRdtscp,
+		KeyReset,
 		KeyReturn,
+		KeyTable,
 		KeyVal,
 		KeyVar,
 		
@@ -0,0 +1,241 @@
+#include "liveness.h"
+
+namespace Compiler {
+	
+	using Statements = std::vector<std::unique_ptr<Parser::Statement>>;
+	
+	struct LivenessState {
+		std::unordered_map<std::string, RegisterSet> liveIn;
+		std::unordered_map<std::string, RegisterSet> liveOut;
+		LiveRegisters &liveAfter;
+		bool changed;
+	};
+	
+	struct LivenessScope {
+		RegisterSet breakLive;
+		RegisterSet continueLive;
+		RegisterSet returnLive;
+	};
+	
+	RegisterSet OperandUses(const Operand &operand) {
+		if (operand.tag == OperandTag::Register) return RegisterBit(dynamic_cast<const RegisterOperand &>(operand).reg);
+		return 0;
+	}
+	
+	RegisterSet ConditionUses(const Condition &condition) {
+		return OperandUses(*condition.a) | OperandUses(*condition.b);
+	}
+	
+	RegisterSet LiveBefore(const Statements &statements, RegisterSet live, const LivenessScope &scope, LivenessState &state);
+	
+	RegisterSet LiveBefore(const Parser::Statement &statement, const RegisterSet after, const LivenessScope &scope, LivenessState &state) {
+		state.liveAfter[&statement] = after;
+		
+		RegisterSet before;
+		switch (statement.tag) {
+			case StatementTag::Assignment: {
+				const auto &stmt = dynamic_cast<const Parser::AssignmentStatement &>(statement);
+				before = (after & ~RegisterBit(stmt.dest)) | OperandUses(*stmt.source);
+				break;
+			}
+			case StatementTag::Shorthand: {
+				const auto &stmt = dynamic_cast<const Parser::ShorthandStatement &>(statement);
+				before = after | RegisterBit(stmt.dest) | OperandUses(*stmt.source);
+				break;
+			}
+			case StatementTag::Longhand: {
+				const auto &stmt = dynamic_cast<const Parser::LonghandStatement &>(statement);
+				before = (after & ~RegisterBit(stmt.dest)) | OperandUses(*stmt.sourceA) | OperandUses(*stmt.sourceB);
+				break;
+			}
+			case StatementTag::DivMod: {
+				const auto &stmt = dynamic_cast<const Parser::DivModStatement &>(statement);
+				before = (after & ~RegisterBit(stmt.quotient) & ~RegisterBit(stmt.remainder)) | OperandUses(*stmt.dividend) | OperandUses(*stmt.divisor);
+				break;
+			}
+			case StatementTag::Loop: {
+				const auto &stmt = dynamic_cast<const Parser::LoopStatement &>(statement);
+				
+				// The loop head is live before the body, iterate until it settles.
+				RegisterSet head = 0;
+				while (true) {
+					const LivenessScope inner{after, head, scope.returnLive};
+					RegisterSet next = LiveBefore(stmt.statements, head, inner, state);
+					if (stmt.condition.has_value()) next |= ConditionUses(*stmt.condition) | after;
+					if (next == head) break;
+					head = next;
+				}
+				return head;
+			}
+			case StatementTag::Branch: {
+				const auto &stmt = dynamic_cast<const Parser::BranchStatement &>(statement);
+				return ConditionUses(*stmt.condition)
+				       | LiveBefore(stmt.statements, after, scope, state)
+				       | LiveBefore(stmt.elseBlock, after, scope, state);
+			}
+			case StatementTag::Break: before = scope.breakLive;
+				break;
+			case StatementTag::Continue: before = scope.continueLive;
+				break;
+			case StatementTag::Return: before = scope.returnLive;
+				break;
+			case StatementTag::Call: {
+				const auto &stmt = dynamic_cast<const Parser::CallStatement &>(statement);
+				
+				auto out = state.liveOut.find(stmt.name);
+				if (out == state.liveOut.end()) {
+					before = ALL_REGISTERS;
+					break;
+				}
+				
+				if ((out->second | after) != out->second) {
+					out->second |= after;
+					state.changed = true;
+				}
+				
+				// The callee might not write any register, so whatever is live after the call stays live.
+				before = state.liveIn[stmt.name] | after;
+				break;
+			}
+			case StatementTag::Stdout: before = after | OperandUses(*dynamic_cast<const Parser::StdoutStatement &>(statement).source);
+				break;
+			case StatementTag::StdoutText: before = after;
+				break;
+			case StatementTag::StdoutBytes: {
+				const auto &stmt = dynamic_cast<const Parser::StdoutBytesStatement &>(statement);
+				before = after | RegisterBit(stmt.address) | OperandUses(*stmt.length);
+				break;
+			}
+			case StatementTag::Stdin: before = after | RegisterBit(dynamic_cast<const Parser::RegisterStatement &>(statement).reg); // Kept at the end of input
+				break;
+			case StatementTag::MapFile: {
+				const auto &stmt = dynamic_cast<const Parser::MapFileStatement &>(statement);
+				before = after & ~RegisterBit(stmt.address) & ~RegisterBit(stmt.length);
+				break;
+			}
+			case StatementTag::Alloc: {
+				const auto &stmt = dynamic_cast<const Parser::AllocStatement &>(statement);
+				before = (after & ~RegisterBit(stmt.dest)) | OperandUses(*stmt.size);
+				break;
+			}
+			case StatementTag::Reset: before = after;
+				break;
+			case StatementTag::Copy: {
+				const auto &stmt = dynamic_cast<const Parser::CopyStatement &>(statement);
+				before = after | RegisterBit(stmt.dest) | RegisterBit(stmt.source) | OperandUses(*stmt.count);
+				break;
+			}
+			case StatementTag::Fill: {
+				const auto &stmt = dynamic_cast<const Parser::FillStatement &>(statement);
+				before = after | RegisterBit(stmt.dest) | OperandUses(*stmt.count) | OperandUses(*stmt.value);
+				break;
+			}
+			case StatementTag::Compare: {
+				const auto &stmt = dynamic_cast<const Parser::CompareStatement &>(statement);
+				before = (after & ~RegisterBit(stmt.dest)) | RegisterBit(stmt.a) | RegisterBit(stmt.b) | OperandUses(*stmt.count);
+				break;
+			}
+			case StatementTag::Find: {
+				const auto &stmt = dynamic_cast<const Parser::FindStatement &>(statement);
+				before = (after & ~RegisterBit(stmt.dest)) | RegisterBit(stmt.address) | OperandUses(*stmt.count) | OperandUses(*stmt.value);
+				break;
+			}
+			case StatementTag::Rdtsc:
+			case StatementTag::Table: before = after & ~RegisterBit(dynamic_cast<const Parser::RegisterStatement &>(statement).reg);
+				break;
+			case StatementTag::Insert:
+			case StatementTag::Lookup:
+			case StatementTag::Increment: {
+				const auto &stmt = dynamic_cast<const Parser::TableStatement &>(statement);
+				before = statement.tag == StatementTag::Insert ? after : after & ~RegisterBit(stmt.dest);
+				before |= RegisterBit(stmt.table) | OperandUses(*stmt.key);
+				if (stmt.value) before |= OperandUses(*stmt.value);
+				break;
+			}
+			case StatementTag::Rdtscp: {
+				const auto &stmt = dynamic_cast<const Parser::RegisterPairStatement &>(statement);
+				before = after & ~RegisterBit(stmt.first) & ~RegisterBit(stmt.second);
+				break;
+			}
+			case StatementTag::Push: before = after | RegisterBit(dynamic_cast<const Parser::RegisterStatement &>(statement).reg);
+				break;
+			case StatementTag::Pop: before = after & ~RegisterBit(dynamic_cast<const Parser::RegisterStatement &>(statement).reg);
+				break;
+			default: before = ALL_REGISTERS;
+				break;
+		}
+		
+		// A conditional statement might be skipped.
+		if (statement.condition.has_value()) before |= after | ConditionUses(*statement.condition);
+		return before;
+	}
+	
+	RegisterSet LiveBefore(const Statements &statements, RegisterSet live, const LivenessScope &scope, LivenessState &state) {
+		for (auto it = statements.rbegin(); it != statements.rend(); ++it) {
+			live = LiveBefore(**it, live, scope, state);
+		}
+		return live;
+	}
+	
+	void AnalyzeLiveness(const std::unordered_map<std::string, Statements> &procedures, LiveRegisters &liveAfter) {
+		// main is entered from the start procedure, which restores every register afterwards.
+		LivenessState state{{}, {}, liveAfter, true};
+		for (const auto &[name, statements]: procedures) {
+			state.liveIn[name] = 0;
+			state.liveOut[name] = 0;
+		}
+		
+		while (state.changed) {
+			state.changed = false;
+			
+			for (const auto &[name, statements]: procedures) {
+				const RegisterSet out = state.liveOut[name];
+				const LivenessScope scope{0, 0, out};
+				const RegisterSet in = LiveBefore(statements, out, scope, state);
+				
+				if (in != state.liveIn[name]) {
+					state.liveIn[name] = in;
+					state.changed = true;
+				}
+			}
+		}
+	}
+	
+	RegisterSet StatementWrites(const Parser::Statement &statement) {
+		switch (statement.tag) {
+			case StatementTag::Assignment: return RegisterBit(dynamic_cast<const Parser::AssignmentStatement &>(statement).dest);
+			case StatementTag::Shorthand: return RegisterBit(dynamic_cast<const Parser::ShorthandStatement &>(statement).dest);
+			case StatementTag::Longhand: return RegisterBit(dynamic_cast<const Parser::LonghandStatement &>(statement).dest);
+			case StatementTag::DivMod: {
+				const auto &stmt = dynamic_cast<const Parser::DivModStatement &>(statement);
+				return RegisterBit(stmt.quotient) | RegisterBit(stmt.remainder);
+			}
+			case StatementTag::Stdout:
+			case StatementTag::StdoutText:
+			case StatementTag::StdoutBytes:
+			case StatementTag::Reset:
+			case StatementTag::Copy:
+			case StatementTag::Fill:
+			case StatementTag::Insert:
+			case StatementTag::Push: return 0;
+			case StatementTag::Stdin:
+			case StatementTag::Table:
+			case StatementTag::Rdtsc:
+			case StatementTag::Pop: return RegisterBit(dynamic_cast<const Parser::RegisterStatement &>(statement).reg);
+			case StatementTag::MapFile: {
+				const auto &stmt = dynamic_cast<const Parser::MapFileStatement &>(statement);
+				return RegisterBit(stmt.address) | RegisterBit(stmt.length);
+			}
+			case StatementTag::Alloc: return RegisterBit(dynamic_cast<const Parser::AllocStatement &>(statement).dest);
+			case StatementTag::Compare: return RegisterBit(dynamic_cast<const Parser::CompareStatement &>(statement).dest);
+			case StatementTag::Find: return RegisterBit(dynamic_cast<const Parser::FindStatement &>(statement).dest);
+			case StatementTag::Lookup:
+			case StatementTag::Increment: return RegisterBit(dynamic_cast<const Parser::TableStatement &>(statement).dest);
+			case StatementTag::Rdtscp: {
+				const auto &stmt = dynamic_cast<const Parser::RegisterPairStatement &>(statement);
+				return RegisterBit(stmt.first) | RegisterBit(stmt.second);
+			}
+			default: return ALL_REGISTERS;
+		}
+	}
+}
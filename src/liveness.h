@@ -0,0 +1,24 @@
+#pragma once
+
+#include "types.h"
+#include "parser.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Compiler {
+	
+	using LiveRegisters = std::unordered_map<const Parser::Statement *, RegisterSet>;
+	
+	/* NOTE Computes the registers that are live right after every statement.
+	 * Procedures share all registers, so the analysis is interprocedural: a
+	 * procedure's registers are live on return if they are live after any call
+	 * to it, and a call keeps alive everything the callee reads.
+	 */
+	void AnalyzeLiveness(const std::unordered_map<std::string, std::vector<std::unique_ptr<Parser::Statement>>> &procedures, LiveRegisters &liveAfter);
+	
+	// Registers a statement might write. A call might write any of them.
+	RegisterSet StatementWrites(const Parser::Statement &statement);
+}
@@ -9,10 +9,23 @@ int main(int argc, char *argv[]) {
 	if (argc < 2) {
 		fprintf(stderr,
 				"Usage: %s [FLAGS] FILE\n"
-				"    --dump-tokens    Dump lexer results\n"
-				"    --dump-ast       Dump parser results\n"
-				"    --dump-code      Dump machine code\n"
-				"    --no-exec        Do not execute compiled code\n",
+				"    --dump-tokens           Dump lexer results\n"
+				"    --dump-ast              Dump parser results\n"
+				"    --dump-ir               Dump the intermediate representation\n"
+				"    --dump-code             Dump machine code\n"
+				"    --no-exec               Do not execute compiled code\n"
+				"    --output-buffer SIZE    Size of the stdout buffer (K, M, G suffixes allowed, default 1M),\n"
+				"                            0 prints every value through stdio\n"
+				"    --no-inline-print       Format numbers with a runtime call instead of inline code\n"
+				"    --input-buffer SIZE     Size of the stdin read-ahead buffer (default 1M)\n"
+				"    --output FILE           Write program output to a memory-mapped FILE instead of stdout\n"
+				"    --freestanding          Write output with syscalls from the generated code, without calls\n"
+				"                            into the runtime (no input, requires an output buffer)\n"
+				"    --stack-size SIZE       Size of the stack compiled code runs on (default 64M)\n"
+				"    --huge-stack            Ask for transparent huge pages to back the stack\n"
+				"    --arena-size SIZE       Address space reserved for alloc statements (default 16G)\n"
+				"    --opt-level LEVEL       0 emits code as generated, 1 propagates constants, analyzes\n"
+				"                            ranges and runs the peephole pass (default 1)\n",
 				argv[0]
 		);
 		return 1;
@@ -22,8 +35,56 @@ int main(int argc, char *argv[]) {
 		const char *arg = argv[argnum];
 		if (strcmp(arg, "--dump-tokens") == 0) Options::flag_dumpTokens = true;
 		else if (strcmp(arg, "--dump-ast") == 0) Options::flag_dumpAst = true;
+		else if (strcmp(arg, "--dump-ir") == 0) Options::flag_dumpIr = true;
 		else if (strcmp(arg, "--dump-code") == 0) Options::flag_dumpCode = true;
 		else if (strcmp(arg, "--no-exec") == 0) Options::flag_noExec = true;
+		else if (strcmp(arg, "--no-inline-print") == 0) Options::flag_inlinePrint = false;
+		else if (strcmp(arg, "--freestanding") == 0) Options::flag_freestanding = true;
+		else if (strcmp(arg, "--huge-stack") == 0) Options::flag_hugeStack = true;
+		else if (strcmp(arg, "--arena-size") == 0 && argnum + 1 < argc - 1) {
+			const char *value = argv[++argnum];
+			if (!ParseSize(value, Options::arenaSize) || Options::arenaSize < ARENA_CHUNK) {
+				fprintf(stderr, "Invalid arena size %s, expected at least 16M\n", value);
+				return 1;
+			}
+			Options::arenaSize = Options::arenaSize / ARENA_CHUNK * ARENA_CHUNK;
+		}
+		else if (strcmp(arg, "--opt-level") == 0 && argnum + 1 < argc - 1) {
+			const char *value = argv[++argnum];
+			if (strcmp(value, "0") != 0 && strcmp(value, "1") != 0) {
+				fprintf(stderr, "Invalid optimization level %s, expected 0 or 1\n", value);
+				return 1;
+			}
+			Options::optimizationLevel = value[0] - '0';
+		}
+		else if (strcmp(arg, "--stack-size") == 0 && argnum + 1 < argc - 1) {
+			const char *value = argv[++argnum];
+			if (!ParseSize(value, Options::stackSize) || Options::stackSize < MIN_STACK_SIZE) {
+				fprintf(stderr, "Invalid stack size %s, expected at least 64K\n", value);
+				return 1;
+			}
+			Options::stackSize = (Options::stackSize + STACK_GUARD_SIZE - 1) & ~(STACK_GUARD_SIZE - 1);
+		}
+		else if (strcmp(arg, "--output") == 0 && argnum + 1 < argc - 1) Options::outputPath = argv[++argnum];
+		else if (strcmp(arg, "--input-buffer") == 0 && argnum + 1 < argc - 1) {
+			const char *value = argv[++argnum];
+			if (!ParseSize(value, Options::inputBufferSize) || Options::inputBufferSize < 64) {
+				fprintf(stderr, "Invalid input buffer size %s, expected at least 64 bytes\n", value);
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "--output-buffer") == 0 && argnum + 1 < argc - 1) {
+			const char *value = argv[++argnum];
+			if (!ParseSize(value, Options::outputBufferSize) || (Options::outputBufferSize != 0 && Options::outputBufferSize < 64)) {
+				fprintf(stderr, "Invalid output buffer size %s, expected 0 or at least 64 bytes\n", value);
+				return 1;
+			}
+		}
+	}
+	
+	if (Options::flag_freestanding && (Options::outputBufferSize == 0 || !Options::flag_inlinePrint)) {
+		fprintf(stderr, "--freestanding needs an output buffer and inline printing\n");
+		return 1;
 	}
 	
 	auto res = RunFile(argv[argc - 1]);
@@ -32,6 +32,10 @@ namespace Parser {
 	
 	[[nodiscard]]  Error ParseAssignment(Statements &statements);
 	
+	[[nodiscard]]  Error ParsePairAssignment(Statements &statements);
+	
+	[[nodiscard]]  Error ParseBuiltinAssignment(Register dest, CodePos pos, Statements &statements);
+	
 	[[nodiscard]]  Error ParseLoop(Statements &statements);
 	
 	[[nodiscard]]  Error ParseBranch(Statements &statements);
@@ -46,10 +50,24 @@ namespace Parser {
 	
 	[[nodiscard]]  Error ParseStdout(Statements &statements);
 	
+	[[nodiscard]]  Error ParseStdin(Statements &statements);
+	
 	[[nodiscard]]  Error ParsePush(Statements &statements);
 	
 	[[nodiscard]]  Error ParsePop(Statements &statements);
 	
+	[[nodiscard]]  Error ParseReset(Statements &statements);
+	
+	[[nodiscard]]  Error ParseCopy(Statements &statements);
+	
+	[[nodiscard]]  Error ParseFill(Statements &statements);
+	
+	[[nodiscard]]  Error ParseInsert(Statements &statements);
+	
+	[[nodiscard]]  Error ParseTableArguments(Register &table, std::unique_ptr<Operand> &key, std::unique_ptr<Operand> *value);
+	
+	[[nodiscard]]  Error ParseAddress(Register &reg);
+	
 	[[nodiscard]] Error Parse(std::vector<std::unique_ptr<Token>> &tokens, std::unordered_map<std::string, Statements> &procedures) {
 		tokenPtr = &tokens.front();
 		tokenEnd = &tokens.back();
@@ -262,7 +280,10 @@ namespace Parser {
 	}
 	
 	[[nodiscard]]  Error ParseStatement(Statements &statements) {
-		Error error = ParseAssignment(statements);
+		Error error = ParsePairAssignment(statements);
+		if (error || parserSuccess) return error;
+		
+		error = ParseAssignment(statements);
 		if (error || parserSuccess) return error;
 		
 		error = ParseLoop(statements);
@@ -286,12 +307,27 @@ namespace Parser {
 		error = ParseStdout(statements);
 		if (error || parserSuccess) return error;
 		
+		error = ParseStdin(statements);
+		if (error || parserSuccess) return error;
+		
 		error = ParsePush(statements);
 		if (error || parserSuccess) return error;
 		
 		error = ParsePop(statements);
 		if (error || parserSuccess) return error;
 		
+		error = ParseReset(statements);
+		if (error || parserSuccess) return error;
+		
+		error = ParseCopy(statements);
+		if (error || parserSuccess) return error;
+		
+		error = ParseFill(statements);
+		if (error || parserSuccess) return error;
+		
+		error = ParseInsert(statements);
+		if (error || parserSuccess) return error;
+		
 		parserSuccess = false;
 		return Error::None;
 	}
@@ -303,7 +339,7 @@ namespace Parser {
 		Error error = ParseRegister(dest);
 		if (!parserSuccess) return error;
 		
-		Operation op;
+		Operation op = Operation::Add;
 		bool isShorthand = true;
 		
 		switch (GetTag()) {
@@ -329,6 +365,11 @@ namespace Parser {
 		}
 		tokenPtr += 1;
 		
+		if (!isShorthand) {
+			Error _error = (ParseBuiltinAssignment(dest, pos, statements));
+			if (_error || parserSuccess) return _error;
+		}
+		
 		std::unique_ptr<Operand> sourceA;
 		Error _error = (ParseOperand(sourceA));
 		if (_error)return _error;
@@ -395,6 +436,243 @@ namespace Parser {
 		return Error::None;
 	}
 	
+	/* NOTE Assignments from built-in statements, e.g. REG = alloc SOURCE, after
+	 * the =. Leaves parserSuccess unset for a plain operand.
+	 */
+	[[nodiscard]]  Error ParseBuiltinAssignment(const Register dest, const CodePos pos, Statements &statements) {
+		if (EatToken(TokenTag::KeyAlloc)) {
+			std::unique_ptr<Operand> size;
+			Error _error = (ParseOperand(size));
+			if (_error)return _error;
+			
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				_error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<AllocStatement>(dest, std::move(size), std::move(condition), pos));
+			return Error::None;
+		}
+		
+		if (IsToken(TokenTag::KeyTable) || IsToken(TokenTag::KeyRdtsc)) {
+			const StatementTag tag = IsToken(TokenTag::KeyTable) ? StatementTag::Table : StatementTag::Rdtsc;
+			tokenPtr += 1;
+			
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				Error _error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<RegisterStatement>(tag, dest, std::move(condition), pos));
+			return Error::None;
+		}
+		
+		if (IsToken(TokenTag::KeyLookup) || IsToken(TokenTag::KeyIncrement)) {
+			const StatementTag tag = IsToken(TokenTag::KeyLookup) ? StatementTag::Lookup : StatementTag::Increment;
+			tokenPtr += 1;
+			
+			Register table;
+			std::unique_ptr<Operand> key, value;
+			Error _error = (ParseTableArguments(table, key, tag == StatementTag::Increment ? &value : nullptr));
+			if (_error)return _error;
+			
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				_error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<TableStatement>(tag, dest, table, std::move(key), std::move(value), std::move(condition), pos));
+			return Error::None;
+		}
+		
+		if (EatToken(TokenTag::KeyCompare)) {
+			Register a, b;
+			Error _error = (ParseAddress(a));
+			if (_error)return _error;
+			if (!EatToken(TokenTag::Comma)) {
+				return Error{"Expected , and the second address.", GetPos()};
+			}
+			_error = (ParseAddress(b));
+			if (_error)return _error;
+			if (!EatToken(TokenTag::Comma)) {
+				return Error{"Expected , and the number of bytes.", GetPos()};
+			}
+			
+			std::unique_ptr<Operand> count;
+			_error = (ParseOperand(count));
+			if (_error)return _error;
+			
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				_error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<CompareStatement>(dest, a, b, std::move(count), std::move(condition), pos));
+			return Error::None;
+		}
+		
+		if (EatToken(TokenTag::KeyFind)) {
+			Register address;
+			Error _error = (ParseAddress(address));
+			if (_error)return _error;
+			if (!EatToken(TokenTag::Comma)) {
+				return Error{"Expected , and the number of bytes.", GetPos()};
+			}
+			
+			std::unique_ptr<Operand> count;
+			_error = (ParseOperand(count));
+			if (_error)return _error;
+			if (!EatToken(TokenTag::Comma)) {
+				return Error{"Expected , and the byte to find.", GetPos()};
+			}
+			
+			std::unique_ptr<Operand> value;
+			_error = (ParseOperand(value));
+			if (_error)return _error;
+			
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				_error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<FindStatement>(dest, address, std::move(count), std::move(value), std::move(condition), pos));
+			return Error::None;
+		}
+		
+		parserSuccess = false;
+		return Error::None;
+	}
+	
+	/* NOTE Statements that produce two results, e.g. REG, REG = mapfile STRING
+	 * or REG, REG = SOURCE divmod SOURCE. Falls back to the other statements
+	 * when the register isn't followed by a comma.
+	 */
+	[[nodiscard]]  Error ParsePairAssignment(Statements &statements) {
+		const CodePos pos = GetPos();
+		std::unique_ptr<Token> *const start = tokenPtr;
+		
+		Register first;
+		Error _error = (ParseRegister(first));
+		if (!parserSuccess) return _error;
+		
+		if (!EatToken(TokenTag::Comma)) {
+			tokenPtr = start;
+			parserSuccess = false;
+			return Error::None;
+		}
+		
+		Register second;
+		_error = (ParseRegister(second));
+		if (_error)return _error;
+		if (!parserSuccess) {
+			return Error{"Expected register.", GetPos()};
+		}
+		if (first == second) {
+			return Error{"Both destination registers are the same.", pos};
+		}
+		
+		if (!EatToken(TokenTag::Equals)) {
+			return Error{"Expected =.", GetPos()};
+		}
+		
+		if (EatToken(TokenTag::KeyRdtscp)) {
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				_error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<RegisterPairStatement>(StatementTag::Rdtscp, first, second, std::move(condition), pos));
+			return Error::None;
+		}
+		
+		if (!EatToken(TokenTag::KeyMapfile)) {
+			std::unique_ptr<Operand> dividend;
+			_error = (ParseOperand(dividend));
+			if (_error) {
+				return Error{"Expected mapfile, rdtscp or divmod.", GetPos()};
+			}
+			if (!EatToken(TokenTag::KeyDivmod)) {
+				return Error{"Expected divmod.", GetPos()};
+			}
+			
+			std::unique_ptr<Operand> divisor;
+			_error = (ParseOperand(divisor));
+			if (_error)return _error;
+			
+			std::optional<Condition> condition;
+			if (EatToken(TokenTag::KeyIf)) {
+				_error = (ParseCondition(condition));
+				if (_error)return _error;
+			}
+			
+			if (!EatToken(TokenTag::Semicolon)) {
+				return Error{"Expected ;.", GetPos()};
+			}
+			
+			parserSuccess = true;
+			statements.emplace_back(std::make_unique<DivModStatement>(first, second, std::move(dividend), std::move(divisor), std::move(condition), pos));
+			return Error::None;
+		}
+		if (!IsToken(TokenTag::String)) {
+			return Error{"Expected file path string.", GetPos()};
+		}
+		std::string path = GetToken<StringToken>()->value;
+		tokenPtr += 1;
+		if (path.find('\0') != std::string::npos) {
+			return Error{"File path can't contain \\0.", pos};
+		}
+		
+		std::optional<Condition> condition;
+		if (EatToken(TokenTag::KeyIf)) {
+			_error = (ParseCondition(condition));
+			if (_error)return _error;
+		}
+		
+		if (!EatToken(TokenTag::Semicolon)) {
+			return Error{"Expected ;.", GetPos()};
+		}
+		
+		parserSuccess = true;
+		statements.emplace_back(std::make_unique<MapFileStatement>(first, second, std::move(path), std::move(condition), pos));
+		return Error::None;
+	}
+	
 	[[nodiscard]]  Error ParseLoop(Statements &statements) {
 		const CodePos pos = GetPos();
 		
@@ -586,14 +864,34 @@ namespace Parser {
 		}
 		
 		bool isText = false;
+		bool isBytes = false;
 		const std::string *text;
 		std::unique_ptr<Operand> source;
+		Register address;
 		
 		if (IsToken(TokenTag::String)) {
 			isText = true;
 			text = &GetToken<StringToken>()->value;
 			tokenPtr += 1;
 		}
+		else if (EatToken(TokenTag::BracketOpen)) {
+			isBytes = true;
+			Error _error = (ParseRegister(address));
+			if (_error)return _error;
+			if (!parserSuccess) {
+				return Error{"Expected register.", GetPos()};
+			}
+			
+			if (!EatToken(TokenTag::BracketClose)) {
+				return Error{"Expected ].", GetPos()};
+			}
+			if (!EatToken(TokenTag::Comma)) {
+				return Error{"Expected , and the number of bytes.", GetPos()};
+			}
+			
+			_error = (ParseOperand(source));
+			if (_error)return _error;
+		}
 		else {
 			Error _error = (ParseOperand(source));
 			if (_error)return _error;
@@ -613,12 +911,45 @@ namespace Parser {
 		if (isText) {
 			statements.emplace_back(std::make_unique<StdoutTextStatement>(*text, std::move(condition), pos));
 		}
+		else if (isBytes) {
+			statements.emplace_back(std::make_unique<StdoutBytesStatement>(address, std::move(source), std::move(condition), pos));
+		}
 		else {
 			statements.emplace_back(std::make_unique<StdoutStatement>(std::move(source), std::move(condition), pos));
 		}
 		return Error::None;
 	}
 	
+	[[nodiscard]]  Error ParseStdin(Statements &statements) {
+		const CodePos pos = GetPos();
+		
+		if (!EatToken(TokenTag::Shr)) {
+			parserSuccess = false;
+			return Error::None;
+		}
+		
+		Register reg;
+		Error _error = (ParseRegister(reg));
+		if (_error)return _error;
+		if (!parserSuccess) {
+			return Error{"Expected register.", GetPos()};
+		}
+		
+		std::optional<Condition> condition;
+		if (EatToken(TokenTag::KeyIf)) {
+			_error = (ParseCondition(condition));
+			if (_error)return _error;
+		}
+		
+		if (!EatToken(TokenTag::Semicolon)) {
+			return Error{"Expected ;.", GetPos()};
+		}
+		
+		parserSuccess = true;
+		statements.emplace_back(std::make_unique<RegisterStatement>(StatementTag::Stdin, reg, std::move(condition), pos));
+		return Error::None;
+	}
+	
 	[[nodiscard]]  Error ParsePush(Statements &statements) {
 		const CodePos pos = GetPos();
 		
@@ -678,4 +1009,171 @@ namespace Parser {
 		statements.emplace_back(std::make_unique<RegisterStatement>(StatementTag::Pop, reg, std::move(condition), pos));
 		return Error::None;
 	}
-}
\ No newline at end of file
+	
+	[[nodiscard]]  Error ParseReset(Statements &statements) {
+		const CodePos pos = GetPos();
+		
+		if (!EatToken(TokenTag::KeyReset)) {
+			parserSuccess = false;
+			return Error::None;
+		}
+		
+		std::optional<Condition> condition;
+		if (EatToken(TokenTag::KeyIf)) {
+			Error _error = (ParseCondition(condition));
+			if (_error)return _error;
+		}
+		
+		if (!EatToken(TokenTag::Semicolon)) {
+			return Error{"Expected ;.", GetPos()};
+		}
+		
+		parserSuccess = true;
+		statements.emplace_back(std::make_unique<Statement>(StatementTag::Reset, pos, std::move(condition)));
+		return Error::None;
+	}
+	
+	[[nodiscard]]  Error ParseCopy(Statements &statements) {
+		const CodePos pos = GetPos();
+		
+		if (!EatToken(TokenTag::KeyCopy)) {
+			parserSuccess = false;
+			return Error::None;
+		}
+		
+		Register dest, source;
+		Error _error = (ParseAddress(dest));
+		if (_error)return _error;
+		if (!EatToken(TokenTag::Comma)) {
+			return Error{"Expected , and the source address.", GetPos()};
+		}
+		_error = (ParseAddress(source));
+		if (_error)return _error;
+		if (!EatToken(TokenTag::Comma)) {
+			return Error{"Expected , and the number of bytes.", GetPos()};
+		}
+		
+		std::unique_ptr<Operand> count;
+		_error = (ParseOperand(count));
+		if (_error)return _error;
+		
+		std::optional<Condition> condition;
+		if (EatToken(TokenTag::KeyIf)) {
+			_error = (ParseCondition(condition));
+			if (_error)return _error;
+		}
+		
+		if (!EatToken(TokenTag::Semicolon)) {
+			return Error{"Expected ;.", GetPos()};
+		}
+		
+		parserSuccess = true;
+		statements.emplace_back(std::make_unique<CopyStatement>(dest, source, std::move(count), std::move(condition), pos));
+		return Error::None;
+	}
+	
+	[[nodiscard]]  Error ParseFill(Statements &statements) {
+		const CodePos pos = GetPos();
+		
+		if (!EatToken(TokenTag::KeyFill)) {
+			parserSuccess = false;
+			return Error::None;
+		}
+		
+		Register dest;
+		Error _error = (ParseAddress(dest));
+		if (_error)return _error;
+		if (!EatToken(TokenTag::Comma)) {
+			return Error{"Expected , and the number of bytes.", GetPos()};
+		}
+		
+		std::unique_ptr<Operand> count;
+		_error = (ParseOperand(count));
+		if (_error)return _error;
+		if (!EatToken(TokenTag::Comma)) {
+			return Error{"Expected , and the byte to fill with.", GetPos()};
+		}
+		
+		std::unique_ptr<Operand> value;
+		_error = (ParseOperand(value));
+		if (_error)return _error;
+		
+		std::optional<Condition> condition;
+		if (EatToken(TokenTag::KeyIf)) {
+			_error = (ParseCondition(condition));
+			if (_error)return _error;
+		}
+		
+		if (!EatToken(TokenTag::Semicolon)) {
+			return Error{"Expected ;.", GetPos()};
+		}
+		
+		parserSuccess = true;
+		statements.emplace_back(std::make_unique<FillStatement>(dest, std::move(count), std::move(value), std::move(condition), pos));
+		return Error::None;
+	}
+	
+	[[nodiscard]]  Error ParseInsert(Statements &statements) {
+		const CodePos pos = GetPos();
+		
+		if (!EatToken(TokenTag::KeyInsert)) {
+			parserSuccess = false;
+			return Error::None;
+		}
+		
+		Register table;
+		std::unique_ptr<Operand> key, value;
+		Error _error = (ParseTableArguments(table, key, &value));
+		if (_error)return _error;
+		
+		std::optional<Condition> condition;
+		if (EatToken(TokenTag::KeyIf)) {
+			_error = (ParseCondition(condition));
+			if (_error)return _error;
+		}
+		
+		if (!EatToken(TokenTag::Semicolon)) {
+			return Error{"Expected ;.", GetPos()};
+		}
+		
+		parserSuccess = true;
+		statements.emplace_back(std::make_unique<TableStatement>(StatementTag::Insert, table, table, std::move(key), std::move(value), std::move(condition), pos));
+		return Error::None;
+	}
+	
+	// [TABLE], KEY and, when value isn't null, VALUE.
+	[[nodiscard]]  Error ParseTableArguments(Register &table, std::unique_ptr<Operand> &key, std::unique_ptr<Operand> *const value) {
+		Error _error = (ParseAddress(table));
+		if (_error)return _error;
+		if (!EatToken(TokenTag::Comma)) {
+			return Error{"Expected , and the key.", GetPos()};
+		}
+		
+		_error = (ParseOperand(key));
+		if (_error)return _error;
+		if (value == nullptr) return Error::None;
+		
+		if (!EatToken(TokenTag::Comma)) {
+			return Error{"Expected , and the value.", GetPos()};
+		}
+		return ParseOperand(*value);
+	}
+	
+	// A register in brackets, standing for the memory it points to.
+	[[nodiscard]]  Error ParseAddress(Register &reg) {
+		if (!EatToken(TokenTag::BracketOpen)) {
+			return Error{"Expected [.", GetPos()};
+		}
+		
+		Error _error = (ParseRegister(reg));
+		if (_error)return _error;
+		if (!parserSuccess) {
+			return Error{"Expected register.", GetPos()};
+		}
+		
+		if (!EatToken(TokenTag::BracketClose)) {
+			return Error{"Expected ].", GetPos()};
+		}
+		return Error::None;
+	}
+}
@@ -56,6 +56,17 @@ namespace Parser {
 		                             sourceB{std::move(sourceB)} {}
 	};
 	
+	struct DivModStatement : public Statement {
+		Register quotient;
+		Register remainder;
+		std::unique_ptr<Operand> dividend;
+		std::unique_ptr<Operand> divisor;
+		
+		DivModStatement(const Register quotient, const Register remainder, std::unique_ptr<Operand> dividend, std::unique_ptr<Operand> divisor,
+				std::optional<Condition> condition, const CodePos pos) : Statement{StatementTag::DivMod, pos, std::move(condition)}, quotient{quotient},
+		                                                             remainder{remainder}, dividend{std::move(dividend)}, divisor{std::move(divisor)} {}
+	};
+	
 	struct LoopStatement : public Statement {
 		std::vector<std::unique_ptr<Statement>> statements;
 		
@@ -86,6 +97,82 @@ namespace Parser {
 		                                                                                               text{std::move(text)} {}
 	};
 	
+	struct StdoutBytesStatement : public Statement {
+		Register address;
+		std::unique_ptr<Operand> length;
+		
+		StdoutBytesStatement(const Register address, std::unique_ptr<Operand> length, std::optional<Condition> condition, const CodePos pos)
+				: Statement{StatementTag::StdoutBytes, pos, std::move(condition)}, address{address}, length{std::move(length)} {}
+	};
+	
+	struct MapFileStatement : public Statement {
+		Register address;
+		Register length;
+		std::string path;
+		
+		MapFileStatement(const Register address, const Register length, std::string path, std::optional<Condition> condition, const CodePos pos)
+				: Statement{StatementTag::MapFile, pos, std::move(condition)}, address{address}, length{length}, path{std::move(path)} {}
+	};
+	
+	struct AllocStatement : public Statement {
+		Register dest;
+		std::unique_ptr<Operand> size;
+		
+		AllocStatement(const Register dest, std::unique_ptr<Operand> size, std::optional<Condition> condition, const CodePos pos)
+				: Statement{StatementTag::Alloc, pos, std::move(condition)}, dest{dest}, size{std::move(size)} {}
+	};
+	
+	struct CopyStatement : public Statement {
+		Register dest;
+		Register source;
+		std::unique_ptr<Operand> count;
+		
+		CopyStatement(const Register dest, const Register source, std::unique_ptr<Operand> count, std::optional<Condition> condition, const CodePos pos)
+				: Statement{StatementTag::Copy, pos, std::move(condition)}, dest{dest}, source{source}, count{std::move(count)} {}
+	};
+	
+	struct FillStatement : public Statement {
+		Register dest;
+		std::unique_ptr<Operand> count;
+		std::unique_ptr<Operand> value;
+		
+		FillStatement(const Register dest, std::unique_ptr<Operand> count, std::unique_ptr<Operand> value, std::optional<Condition> condition, const CodePos pos)
+				: Statement{StatementTag::Fill, pos, std::move(condition)}, dest{dest}, count{std::move(count)}, value{std::move(value)} {}
+	};
+	
+	struct CompareStatement : public Statement {
+		Register dest;
+		Register a;
+		Register b;
+		std::unique_ptr<Operand> count;
+		
+		CompareStatement(const Register dest, const Register a, const Register b, std::unique_ptr<Operand> count, std::optional<Condition> condition, const CodePos pos)
+				: Statement{StatementTag::Compare, pos, std::move(condition)}, dest{dest}, a{a}, b{b}, count{std::move(count)} {}
+	};
+	
+	struct FindStatement : public Statement {
+		Register dest;
+		Register address;
+		std::unique_ptr<Operand> count;
+		std::unique_ptr<Operand> value;
+		
+		FindStatement(const Register dest, const Register address, std::unique_ptr<Operand> count, std::unique_ptr<Operand> value, std::optional<Condition> condition,
+		              const CodePos pos)
+				: Statement{StatementTag::Find, pos, std::move(condition)}, dest{dest}, address{address}, count{std::move(count)}, value{std::move(value)} {}
+	};
+	
+	// Insert has no destination, and lookup no value.
+	struct TableStatement : public Statement {
+		Register dest;
+		Register table;
+		std::unique_ptr<Operand> key;
+		std::unique_ptr<Operand> value;
+		
+		TableStatement(const StatementTag tag, const Register dest, const Register table, std::unique_ptr<Operand> key, std::unique_ptr<Operand> value,
+		               std::optional<Condition> condition, const CodePos pos)
+				: Statement{tag, pos, std::move(condition)}, dest{dest}, table{table}, key{std::move(key)}, value{std::move(value)} {}
+	};
+	
 	struct CallStatement : public Statement {
 		std::string name;
 		
@@ -99,5 +186,13 @@ namespace Parser {
 		                                                                                                                       reg{reg} {}
 	};
 	
+	struct RegisterPairStatement : public Statement {
+		Register first;
+		Register second;
+		
+		RegisterPairStatement(const StatementTag tag, const Register first, const Register second, std::optional<Condition> condition, const CodePos pos)
+				: Statement{tag, pos, std::move(condition)}, first{first}, second{second} {}
+	};
+	
 	[[nodiscard]] Error Parse(std::vector<std::unique_ptr<Lexer::Token>> &tokens, std::unordered_map<std::string, std::vector<std::unique_ptr<Statement>>> &procedures);
 }
\ No newline at end of file
@@ -0,0 +1,554 @@
+#include "peephole.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+namespace Compiler {
+	
+	enum class InstructionKind : uint8_t {
+		Other,
+		Nop,
+		Padding,
+		Jump,
+		ConditionalJump,
+		Call,
+		CallPlaceholder,
+		Return,
+	};
+	
+	/* NOTE Positions are offsets into the whole machine code. Branches keep
+	 * their absolute target, which is also used for code-relative RIP operands
+	 * that aren't section references.
+	 */
+	struct Instruction {
+		size_t pos;
+		size_t newPos;
+		uint8_t length;
+		InstructionKind kind;
+		size_t target;
+		int8_t ripDisp;
+		bool sectionRef;
+		bool removed;
+		bool shortBranch;
+		bool aligned;
+	};
+	
+	struct PeepholeState {
+		std::vector<Instruction> instructions;
+		std::unordered_map<size_t, size_t> indexOf;
+		size_t begin;
+		size_t end;
+	};
+	
+	constexpr size_t MAX_INSTRUCTION_LENGTH = 15;
+	
+	// jmp rel8 and jcc rel8
+	constexpr uint8_t SHORT_BRANCH_LENGTH = 2;
+	
+	[[nodiscard]] bool DecodeModRM(const MachineCode &code, size_t &i, const size_t end, Instruction &instr) {
+		if (i >= end) return false;
+		const uint8_t modrm = code[i++];
+		const uint8_t mod = modrm >> 6;
+		const uint8_t rm = modrm & 0x07;
+		if (mod == 0b11) return true;
+		
+		if (rm == 0b100) {
+			if (i >= end) return false;
+			const uint8_t sib = code[i++];
+			if (mod == 0b00 && (sib & 0x07) == 0b101) i += 4;
+		}
+		else if (mod == 0b00 && rm == 0b101) {
+			instr.ripDisp = static_cast<int8_t>(i - instr.pos);
+			i += 4;
+		}
+		
+		if (mod == 0b01) i += 1;
+		else if (mod == 0b10) i += 4;
+		return i <= end;
+	}
+	
+	/* NOTE Only decodes what the code generator emits: the 66 and F3 prefixes,
+	 * one REX prefix, the integer instructions and the handful of SSE2 and
+	 * system instructions it uses. Short branches only appear once the pass is
+	 * done and indirect jumps are never emitted, so they are rejected along
+	 * with everything else.
+	 */
+	[[nodiscard]] bool DecodeInstruction(const MachineCode &code, const size_t pos, const size_t end, Instruction &instr) {
+		instr = Instruction{pos, 0, 0, InstructionKind::Other, 0, -1, false, false, false, false};
+		
+		size_t i = pos;
+		bool operandSize = false;
+		while (i < end && (code[i] == 0x66 || code[i] == 0xF3)) {
+			if (code[i] == 0x66) operandSize = true;
+			++i;
+		}
+		
+		bool rexW = false;
+		if (i < end && (code[i] & 0xF0) == 0x40) rexW = code[i++] & 0x08;
+		if (i >= end) return false;
+		
+		const size_t opcodePos = i;
+		const uint8_t opcode = code[i++];
+		const size_t imm32 = operandSize ? 2 : 4;
+		bool modrm = false;
+		size_t imm = 0;
+		size_t rel = 0;
+		
+		if (opcode == 0x0F) {
+			if (i >= end) return false;
+			const uint8_t opcode2 = code[i++];
+			
+			if ((opcode2 & 0xF0) == 0x80) {
+				instr.kind = InstructionKind::ConditionalJump;
+				rel = 4;
+			}
+			else if ((opcode2 & 0xF0) == 0x40 || (opcode2 & 0xF0) == 0x90) modrm = true;
+			else if (opcode2 == 0x1F) {
+				instr.kind = InstructionKind::Padding;
+				modrm = true;
+			}
+			else {
+				switch (opcode2) {
+					case 0x05:
+					case 0x31:
+					case 0xA2: break;
+					case 0x01:
+					case 0x10:
+					case 0x11:
+					case 0x6C:
+					case 0x6E:
+					case 0x6F:
+					case 0x74:
+					case 0x7E:
+					case 0x7F:
+					case 0xAE:
+					case 0xAF:
+					case 0xB6:
+					case 0xB7:
+					case 0xBC:
+					case 0xBE:
+					case 0xBF:
+					case 0xD6:
+					case 0xD7:
+					case 0xEF: modrm = true;
+						break;
+					default: return false;
+				}
+			}
+		}
+		else if (opcode < 0x40) {
+			switch (opcode & 0x07) {
+				case 0:
+				case 1:
+				case 2:
+				case 3: modrm = true;
+					break;
+				case 4: imm = 1;
+					break;
+				case 5: imm = imm32;
+					break;
+				default: return false;
+			}
+		}
+		else if (opcode >= 0x50 && opcode <= 0x5F) {}
+		else if (opcode >= 0xB0 && opcode <= 0xB7) imm = 1;
+		else if (opcode >= 0xB8 && opcode <= 0xBF) imm = rexW ? 8 : imm32;
+		else {
+			switch (opcode) {
+				case 0x63:
+				case 0x84:
+				case 0x85:
+				case 0x86:
+				case 0x87:
+				case 0x88:
+				case 0x89:
+				case 0x8A:
+				case 0x8B:
+				case 0x8D:
+				case 0x8F:
+				case 0xD1:
+				case 0xD3: modrm = true;
+					break;
+				case 0x69:
+				case 0x81:
+				case 0xC7: modrm = true;
+					imm = imm32;
+					break;
+				case 0x6B:
+				case 0x80:
+				case 0x83:
+				case 0xC0:
+				case 0xC1:
+				case 0xC6: modrm = true;
+					imm = 1;
+					break;
+				case 0xF6:
+				case 0xF7: {
+					if (i >= end) return false;
+					modrm = true;
+					if (((code[i] >> 3) & 0x07) < 2) imm = opcode == 0xF6 ? 1 : imm32;
+					break;
+				}
+				case 0xFF: {
+					// Indirect jumps and far calls have no known target
+					if (i >= end) return false;
+					const uint8_t reg = (code[i] >> 3) & 0x07;
+					if (reg >= 3 && reg <= 5) return false;
+					modrm = true;
+					break;
+				}
+				case 0x68: imm = 4;
+					break;
+				case 0x6A: imm = 1;
+					break;
+				case 0x90:
+					if (opcodePos == pos) instr.kind = InstructionKind::Nop;
+					else if (operandSize) instr.kind = InstructionKind::Padding;
+					break;
+				case 0x98:
+				case 0x99:
+				case 0x9C:
+				case 0x9D:
+				case 0xA4:
+				case 0xA5:
+				case 0xAA:
+				case 0xAB:
+				case 0xCC:
+				case 0xF4:
+				case 0xFC: break;
+				case 0xC3: instr.kind = InstructionKind::Return;
+					break;
+				case 0xE8: instr.kind = InstructionKind::Call;
+					rel = 4;
+					break;
+				case 0xE9: instr.kind = InstructionKind::Jump;
+					rel = 4;
+					break;
+				default: return false;
+			}
+		}
+		
+		if (modrm && !DecodeModRM(code, i, end, instr)) return false;
+		i += imm + rel;
+		if (i > end || i - pos > MAX_INSTRUCTION_LENGTH) return false;
+		
+		instr.length = static_cast<uint8_t>(i - pos);
+		if (rel || instr.ripDisp >= 0) {
+			const size_t dispPos = rel ? i - 4 : pos + instr.ripDisp;
+			int32_t diff;
+			memcpy(&diff, &code[dispPos], 4);
+			instr.target = static_cast<size_t>(static_cast<int64_t>(i) + diff);
+		}
+		
+		return true;
+	}
+	
+	bool IsBranch(const Instruction &instr) {
+		return instr.kind == InstructionKind::Jump || instr.kind == InstructionKind::ConditionalJump;
+	}
+	
+	bool HasCodeTarget(const Instruction &instr) {
+		return IsBranch(instr) || instr.kind == InstructionKind::Call || (instr.ripDisp >= 0 && !instr.sectionRef);
+	}
+	
+	bool IsInside(const PeepholeState &state, const size_t pos) {
+		return pos >= state.begin && pos <= state.end;
+	}
+	
+	// First instruction at or after pos that is still there, or the end of the procedure.
+	size_t Resolve(const PeepholeState &state, const size_t pos) {
+		if (!IsInside(state, pos) || pos == state.end) return pos;
+		
+		for (size_t index = state.indexOf.at(pos); index < state.instructions.size(); ++index) {
+			if (!state.instructions[index].removed) return state.instructions[index].pos;
+		}
+		return state.end;
+	}
+	
+	std::unordered_set<size_t> CollectTargets(const PeepholeState &state) {
+		std::unordered_set<size_t> targets{state.begin};
+		for (const auto &instr: state.instructions) {
+			if (!instr.removed && HasCodeTarget(instr) && IsInside(state, instr.target)) targets.insert(Resolve(state, instr.target));
+		}
+		return targets;
+	}
+	
+	// mov r64, r64 with the same register on both sides
+	bool IsSelfMove(const MachineCode &code, const Instruction &instr) {
+		if (instr.length != 3) return false;
+		const unsigned char *bytes = &code[instr.pos];
+		if ((bytes[0] & 0xFA) != 0x48 || ((bytes[0] >> 2) & 1) != (bytes[0] & 1)) return false;
+		if (bytes[1] != 0x89 && bytes[1] != 0x8B) return false;
+		return (bytes[2] >> 6) == 0b11 && ((bytes[2] >> 3) & 0x07) == (bytes[2] & 0x07);
+	}
+	
+	/* NOTE A store of a register to [rsp+disp] followed by a load of the same
+	 * register from the same slot, or the other way around. The second one
+	 * doesn't change anything. Loading rsp itself would move the slot.
+	 */
+	bool IsStackPair(const MachineCode &code, const Instruction &first, const Instruction &second) {
+		if (first.length != second.length || (first.length != 5 && first.length != 8)) return false;
+		
+		const unsigned char *a = &code[first.pos];
+		const unsigned char *b = &code[second.pos];
+		if ((a[0] & 0xFB) != 0x48 || a[0] != b[0]) return false;
+		if (!((a[1] == 0x89 && b[1] == 0x8B) || (a[1] == 0x8B && b[1] == 0x89))) return false;
+		
+		const uint8_t mod = a[2] >> 6;
+		if ((mod == 0b01 ? 5 : 8) != first.length || mod == 0b00 || mod == 0b11) return false;
+		if ((a[2] & 0x07) != 0b100 || a[3] != 0x24) return false;
+		if (a[0] == 0x48 && ((a[2] >> 3) & 0x07) == 0b100) return false;
+		
+		return memcmp(a + 2, b + 2, first.length - 2) == 0;
+	}
+	
+	bool RemoveNops(const MachineCode &code, PeepholeState &state) {
+		bool changed = false;
+		for (auto &instr: state.instructions) {
+			if (!instr.removed && (instr.kind == InstructionKind::Nop || instr.kind == InstructionKind::Padding || IsSelfMove(code, instr))) {
+				instr.removed = true;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+	
+	bool ThreadJumps(PeepholeState &state) {
+		bool changed = false;
+		for (auto &instr: state.instructions) {
+			if (instr.removed || !IsBranch(instr) || !IsInside(state, instr.target)) continue;
+			
+			const size_t first = Resolve(state, instr.target);
+			size_t target = first;
+			std::unordered_set<size_t> seen{instr.pos};
+			while (target != state.end) {
+				const auto &next = state.instructions[state.indexOf.at(target)];
+				if (next.kind != InstructionKind::Jump || !IsInside(state, next.target)) break;
+				if (!seen.insert(target).second) {
+					// Jumps going around in a circle stay as they are
+					target = first;
+					break;
+				}
+				target = Resolve(state, next.target);
+			}
+			
+			if (target != first) changed = true;
+			instr.target = target;
+		}
+		return changed;
+	}
+	
+	bool RemoveJumpsToNext(PeepholeState &state) {
+		bool changed = false;
+		for (auto &instr: state.instructions) {
+			if (instr.removed || !IsBranch(instr) || !IsInside(state, instr.target)) continue;
+			
+			if (Resolve(state, instr.target) == Resolve(state, instr.pos + instr.length)) {
+				instr.removed = true;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+	
+	bool RemoveStackReloads(const MachineCode &code, PeepholeState &state) {
+		const auto targets = CollectTargets(state);
+		bool changed = false;
+		const Instruction *previous = nullptr;
+		for (auto &instr: state.instructions) {
+			if (instr.removed) continue;
+			
+			if (previous && !targets.count(instr.pos) && IsStackPair(code, *previous, instr)) {
+				instr.removed = true;
+				changed = true;
+				continue;
+			}
+			previous = &instr;
+		}
+		return changed;
+	}
+	
+	bool RemoveUnreachable(PeepholeState &state) {
+		const auto targets = CollectTargets(state);
+		bool changed = false;
+		bool reachable = true;
+		for (auto &instr: state.instructions) {
+			if (instr.removed) continue;
+			
+			if (targets.count(instr.pos)) reachable = true;
+			if (!reachable) {
+				instr.removed = true;
+				changed = true;
+				continue;
+			}
+			if (instr.kind == InstructionKind::Jump || instr.kind == InstructionKind::Return) reachable = false;
+		}
+		return changed;
+	}
+	
+	uint8_t LaidOutLength(const Instruction &instr) {
+		return instr.shortBranch ? SHORT_BRANCH_LENGTH : instr.length;
+	}
+	
+	// Gives every remaining instruction its new position and returns the new end of the procedure.
+	size_t Layout(PeepholeState &state) {
+		size_t newEnd = state.begin;
+		for (auto &instr: state.instructions) {
+			if (instr.removed) continue;
+			if (instr.aligned) newEnd = (newEnd + LOOP_ALIGNMENT - 1) / LOOP_ALIGNMENT * LOOP_ALIGNMENT;
+			instr.newPos = newEnd;
+			newEnd += LaidOutLength(instr);
+		}
+		return newEnd;
+	}
+	
+	size_t NewPosition(const PeepholeState &state, const size_t pos, const size_t newEnd) {
+		if (!IsInside(state, pos)) return pos;
+		const size_t resolved = Resolve(state, pos);
+		return resolved == state.end ? newEnd : state.instructions[state.indexOf.at(resolved)].newPos;
+	}
+	
+	/* NOTE Gives branches inside the procedure their rel8 form wherever the
+	 * displacement fits, and returns the new end. Every branch starts out
+	 * short and the ones that don't reach grow back to rel32 until none is
+	 * left. Padding in front of a loop head can get longer when the code
+	 * before it gets shorter, so shortening alone could push a short branch
+	 * out of reach. Growing only ever happens once per branch, so the loop
+	 * ends.
+	 */
+	size_t RelaxBranches(PeepholeState &state, size_t &shortened) {
+		shortened = 0;
+		for (auto &instr: state.instructions) {
+			if (instr.removed || !IsBranch(instr) || !IsInside(state, instr.target)) continue;
+			instr.shortBranch = true;
+			++shortened;
+		}
+		
+		bool changed = true;
+		size_t newEnd = Layout(state);
+		while (changed) {
+			changed = false;
+			for (auto &instr: state.instructions) {
+				if (instr.removed || !instr.shortBranch) continue;
+				
+				const auto diff = static_cast<int64_t>(NewPosition(state, instr.target, newEnd)) - static_cast<int64_t>(instr.newPos + SHORT_BRANCH_LENGTH);
+				if (diff < INT8_MIN || diff > INT8_MAX) {
+					instr.shortBranch = false;
+					--shortened;
+					changed = true;
+				}
+			}
+			newEnd = Layout(state);
+		}
+		return newEnd;
+	}
+	
+	void OptimizeProcedure(MachineCode &code, const size_t begin, std::unordered_map<size_t, std::string> &callTable, std::vector<SectionRef> &sectionRefs,
+	                       const std::vector<size_t> &loopHeads, PeepholeStats &stats) {
+		PeepholeState state{{}, {}, begin, code.length()};
+		stats.instructions = 0;
+		stats.removedInstructions = 0;
+		stats.bytes = state.end - begin;
+		stats.removedBytes = 0;
+		stats.shortBranches = 0;
+		stats.skipped = true;
+		
+		for (size_t pos = begin; pos < state.end;) {
+			Instruction instr;
+			if (callTable.count(pos)) instr = Instruction{pos, 0, 5, InstructionKind::CallPlaceholder, 0, -1, false, false, false, false};
+			else if (!DecodeInstruction(code, pos, state.end, instr)) return;
+			
+			state.indexOf[pos] = state.instructions.size();
+			state.instructions.push_back(instr);
+			pos += instr.length;
+		}
+		
+		std::unordered_set<size_t> refs;
+		for (const auto &ref: sectionRefs) {
+			if (ref.from >= begin && ref.from < state.end) refs.insert(ref.from);
+		}
+		
+		// Every section reference has to be a RIP operand and every branch has to land on an instruction
+		std::unordered_map<size_t, size_t> refInstruction;
+		for (size_t index = 0; index < state.instructions.size(); ++index) {
+			auto &instr = state.instructions[index];
+			if (instr.ripDisp >= 0 && refs.count(instr.pos + instr.ripDisp)) {
+				instr.sectionRef = true;
+				refInstruction[instr.pos + instr.ripDisp] = index;
+			}
+			if (HasCodeTarget(instr) && IsInside(state, instr.target) && instr.target != state.end && !state.indexOf.count(instr.target)) return;
+		}
+		if (refInstruction.size() != refs.size()) return;
+		
+		bool changed = true;
+		while (changed) {
+			changed = RemoveNops(code, state);
+			changed |= ThreadJumps(state);
+			changed |= RemoveJumpsToNext(state);
+			changed |= RemoveStackReloads(code, state);
+			changed |= RemoveUnreachable(state);
+		}
+		
+		// The padding was removed along with the NOPs, a loop head that went away passes its alignment on to what follows.
+		for (const size_t head: loopHeads) {
+			const size_t resolved = Resolve(state, head);
+			if (resolved != state.end) state.instructions[state.indexOf.at(resolved)].aligned = true;
+		}
+		
+		const size_t newEnd = RelaxBranches(state, stats.shortBranches);
+		
+		MachineCode optimized;
+		for (const auto &instr: state.instructions) {
+			if (instr.removed) continue;
+			
+			Gen::EmitPadding(instr.newPos - begin - optimized.length(), optimized);
+			const auto displacement = [&]() {
+				return static_cast<int32_t>(NewPosition(state, instr.target, newEnd)) - static_cast<int32_t>(instr.newPos + LaidOutLength(instr));
+			};
+			
+			if (instr.shortBranch) {
+				// E9 becomes EB, and 0F 8x becomes 7x
+				optimized.push_back(instr.kind == InstructionKind::Jump ? 0xEB : code[instr.pos + 1] - 0x10);
+				optimized.push_back(static_cast<uint8_t>(static_cast<int8_t>(displacement())));
+				continue;
+			}
+			
+			optimized.append(code, instr.pos, instr.length);
+			if (HasCodeTarget(instr)) {
+				const size_t dispPos = optimized.length() - instr.length + (instr.ripDisp >= 0 ? instr.ripDisp : instr.length - 4);
+				const int32_t diff = displacement();
+				memcpy(&optimized[dispPos], &diff, 4);
+			}
+		}
+		
+		std::vector<std::pair<size_t, std::string>> calls;
+		for (auto it = callTable.begin(); it != callTable.end();) {
+			if (it->first >= begin && it->first < state.end) {
+				calls.emplace_back(it->first, std::move(it->second));
+				it = callTable.erase(it);
+			}
+			else ++it;
+		}
+		for (auto &[pos, name]: calls) {
+			const auto &instr = state.instructions[state.indexOf.at(pos)];
+			if (!instr.removed) callTable[instr.newPos] = std::move(name);
+		}
+		
+		for (auto &ref: sectionRefs) {
+			if (ref.from < begin || ref.from >= state.end) continue;
+			const auto &instr = state.instructions[refInstruction.at(ref.from)];
+			ref.from = instr.removed ? SIZE_MAX : instr.newPos + instr.ripDisp;
+		}
+		sectionRefs.erase(std::remove_if(sectionRefs.begin(), sectionRefs.end(), [](const SectionRef &ref) { return ref.from == SIZE_MAX; }), sectionRefs.end());
+		
+		code.resize(begin);
+		code.append(optimized);
+		
+		stats.instructions = state.instructions.size();
+		stats.removedInstructions = static_cast<size_t>(std::count_if(state.instructions.begin(), state.instructions.end(), [](const Instruction &instr) { return instr.removed; }));
+		// Padding a loop head that moved onto the next instruction can add a few bytes
+		stats.removedBytes = stats.bytes - std::min(stats.bytes, optimized.length());
+		stats.skipped = false;
+	}
+}
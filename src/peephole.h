@@ -0,0 +1,27 @@
+#pragma once
+
+#include "compiler.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Compiler {
+	
+	/* NOTE Cleans up the machine code of a single procedure, which runs from
+	 * begin to the end of code. The bytes are decoded back into an instruction
+	 * list, so only the encodings the code generator produces are understood;
+	 * anything else leaves the procedure untouched and marks it as skipped.
+	 *
+	 * The pass removes leftover NOP placeholders, 64 bit moves of a register to
+	 * itself, jumps to the next instruction, unreachable code after jumps and
+	 * returns and the second half of a red-zone store/reload pair, and threads
+	 * jumps that land on unconditional jumps. The remaining instructions are
+	 * laid out again, with relative branches, call placeholders in callTable
+	 * and section references inside the procedure moved along. Branches
+	 * within the procedure take the two byte rel8 form wherever it reaches.
+	 * The instructions at loopHeads are padded to LOOP_ALIGNMENT again.
+	 */
+	void OptimizeProcedure(MachineCode &code, size_t begin, std::unordered_map<size_t, std::string> &callTable, std::vector<SectionRef> &sectionRefs,
+	                       const std::vector<size_t> &loopHeads, PeepholeStats &stats);
+}
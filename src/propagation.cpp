@@ -0,0 +1,237 @@
+#include "propagation.h"
+#include "liveness.h"
+
+#include <array>
+#include <optional>
+#include <vector>
+
+namespace Compiler::IR {
+	
+	// The value of a register is kept at its encoding, but only means something when the register is known.
+	struct Constants {
+		RegisterSet known;
+		std::array<int64_t, 16> values;
+	};
+	
+	bool operator==(const Constants &a, const Constants &b) {
+		if (a.known != b.known) return false;
+		for (size_t i = 0; i < a.values.size(); ++i) {
+			if ((a.known & (1u << i)) && a.values[i] != b.values[i]) return false;
+		}
+		return true;
+	}
+	
+	// What is known where two paths meet: the registers that hold the same value on both.
+	Constants Meet(const Constants &a, const Constants &b) {
+		Constants result = a;
+		result.known &= b.known;
+		for (size_t i = 0; i < a.values.size(); ++i) {
+			if (a.values[i] != b.values[i]) result.known &= static_cast<RegisterSet>(~(1u << i));
+		}
+		return result;
+	}
+	
+	void Set(Constants &constants, const Register reg, const int64_t value) {
+		constants.known |= RegisterBit(reg);
+		constants.values[static_cast<uint8_t>(reg)] = value;
+	}
+	
+	Value Resolve(const Constants &constants, const Value &value) {
+		if (value.tag == OperandTag::Register && (constants.known & RegisterBit(value.reg))) {
+			return Value{OperandTag::Immediate, Register::rax, constants.values[static_cast<uint8_t>(value.reg)]};
+		}
+		return value;
+	}
+	
+	// Larger immediates would have to be loaded from the constant pool, a register is better.
+	Value Substitute(const Constants &constants, const Value &value) {
+		const Value resolved = Resolve(constants, value);
+		if (resolved.tag == OperandTag::Immediate && resolved.value >= INT32_MIN && resolved.value <= INT32_MAX) return resolved;
+		return value;
+	}
+	
+	// Division by zero and the one quotient that overflows are left to fault at run time.
+	bool Fold(const Operation op, const int64_t a, const int64_t b, int64_t &result) {
+		const auto ua = static_cast<uint64_t>(a);
+		const auto ub = static_cast<uint64_t>(b);
+		switch (op) {
+			case Operation::Add: result = static_cast<int64_t>(ua + ub);
+				return true;
+			case Operation::Sub: result = static_cast<int64_t>(ua - ub);
+				return true;
+			case Operation::Mul: result = static_cast<int64_t>(ua * ub);
+				return true;
+			case Operation::And: result = a & b;
+				return true;
+			case Operation::Or: result = a | b;
+				return true;
+			case Operation::Xor: result = a ^ b;
+				return true;
+			case Operation::Div:
+			case Operation::Mod:
+				if (b == 0 || (a == INT64_MIN && b == -1)) return false;
+				result = op == Operation::Div ? a / b : a % b;
+				return true;
+		}
+		return false;
+	}
+	
+	bool Compare(const Comparison comp, const int64_t a, const int64_t b) {
+		switch (comp) {
+			case Comparison::LessThan: return a < b;
+			case Comparison::LessEquals: return a <= b;
+			case Comparison::GreaterThan: return a > b;
+			case Comparison::GreaterEquals: return a >= b;
+			case Comparison::Equals: return a == b;
+			case Comparison::NotEquals: return a != b;
+		}
+		return false;
+	}
+	
+	std::optional<bool> Decide(const Constants &constants, const Condition &condition) {
+		const Value a = Resolve(constants, condition.a);
+		const Value b = Resolve(constants, condition.b);
+		if (a.tag == OperandTag::Immediate && b.tag == OperandTag::Immediate) return Compare(condition.comp, a.value, b.value);
+		if (a.tag == OperandTag::Register && b.tag == OperandTag::Register && a.reg == b.reg) return Compare(condition.comp, 0, 0);
+		return std::nullopt;
+	}
+	
+	/* NOTE Runs the block on what is known at its start, leaving what is known
+	 * at its end. With rewrite set the block is changed to use it on the way.
+	 */
+	void Transfer(Block &block, Constants &constants, const bool rewrite) {
+		std::vector<Instruction> instructions;
+		for (Instruction instruction: block.instructions) {
+			switch (instruction.tag) {
+				case InstructionTag::Move: {
+					const Value a = Resolve(constants, instruction.a);
+					if (a.tag == OperandTag::Immediate) Set(constants, instruction.dest, a.value);
+					else constants.known &= ~RegisterBit(instruction.dest);
+					break;
+				}
+				case InstructionTag::Binary: {
+					const Value a = Resolve(constants, instruction.a);
+					const Value b = Resolve(constants, instruction.b);
+					int64_t result;
+					if (a.tag == OperandTag::Immediate && b.tag == OperandTag::Immediate && Fold(instruction.op, a.value, b.value, result)) {
+						if (rewrite) {
+							instruction.tag = InstructionTag::Move;
+							instruction.a = Value{OperandTag::Immediate, Register::rax, result};
+						}
+						Set(constants, instruction.dest, result);
+						break;
+					}
+					
+					if (rewrite) {
+						instruction.a = Substitute(constants, instruction.a);
+						instruction.b = Substitute(constants, instruction.b);
+					}
+					constants.known &= ~RegisterBit(instruction.dest);
+					break;
+				}
+				case InstructionTag::DivMod: {
+					const Value a = Resolve(constants, instruction.a);
+					const Value b = Resolve(constants, instruction.b);
+					int64_t quotient;
+					int64_t remainder;
+					if (a.tag == OperandTag::Immediate && b.tag == OperandTag::Immediate && Fold(Operation::Div, a.value, b.value, quotient)
+					    && Fold(Operation::Mod, a.value, b.value, remainder)) {
+						Set(constants, instruction.dest, quotient);
+						Set(constants, instruction.remainder, remainder);
+						if (rewrite) {
+							const Value value{OperandTag::Immediate, Register::rax, quotient};
+							instructions.push_back(Instruction{InstructionTag::Move, Operation::Add, instruction.dest, value, {}, Register::rax, instruction.statement});
+							instruction.tag = InstructionTag::Move;
+							instruction.dest = instruction.remainder;
+							instruction.a = Value{OperandTag::Immediate, Register::rax, remainder};
+						}
+						break;
+					}
+					
+					if (rewrite) {
+						instruction.a = Substitute(constants, instruction.a);
+						instruction.b = Substitute(constants, instruction.b);
+					}
+					constants.known &= ~RegisterBit(instruction.dest) & ~RegisterBit(instruction.remainder);
+					break;
+				}
+				case InstructionTag::Statement: constants.known &= ~StatementWrites(*instruction.statement);
+					break;
+			}
+			if (rewrite) instructions.push_back(instruction);
+		}
+		if (rewrite) block.instructions = std::move(instructions);
+		
+		Terminator &terminator = block.terminator;
+		if (!rewrite || terminator.tag != TerminatorTag::Branch) return;
+		
+		const std::optional<bool> outcome = Decide(constants, terminator.condition);
+		if (outcome.has_value()) {
+			terminator.tag = TerminatorTag::Jump;
+			if (!*outcome) terminator.target = terminator.otherwise;
+			return;
+		}
+		
+		terminator.condition.a = Substitute(constants, terminator.condition.a);
+		terminator.condition.b = Substitute(constants, terminator.condition.b);
+		Normalize(terminator.condition);
+	}
+	
+	std::vector<size_t> Successors(const Terminator &terminator, const Constants &constants) {
+		switch (terminator.tag) {
+			case TerminatorTag::Jump: return {terminator.target};
+			case TerminatorTag::Branch: {
+				const std::optional<bool> outcome = Decide(constants, terminator.condition);
+				if (outcome.has_value()) return {*outcome ? terminator.target : terminator.otherwise};
+				return {terminator.target, terminator.otherwise};
+			}
+			case TerminatorTag::Return: return {};
+		}
+		return {};
+	}
+	
+	void PropagateConstants(Procedure &procedure) {
+		const size_t count = procedure.blocks.size();
+		std::vector<Constants> in(count);
+		std::vector<bool> reached(count, false);
+		
+		in[0] = Constants{0, {}};
+		reached[0] = true;
+		std::vector<size_t> worklist{0};
+		while (!worklist.empty()) {
+			const size_t index = worklist.back();
+			worklist.pop_back();
+			
+			Constants out = in[index];
+			Transfer(procedure.blocks[index], out, false);
+			for (const size_t successor: Successors(procedure.blocks[index].terminator, out)) {
+				const Constants merged = reached[successor] ? Meet(in[successor], out) : out;
+				if (reached[successor] && merged == in[successor]) continue;
+				
+				in[successor] = merged;
+				reached[successor] = true;
+				worklist.push_back(successor);
+			}
+		}
+		
+		std::vector<size_t> index(count);
+		std::vector<Block> blocks;
+		for (size_t i = 0; i < count; ++i) {
+			if (!reached[i]) continue;
+			
+			Transfer(procedure.blocks[i], in[i], true);
+			index[i] = blocks.size();
+			blocks.push_back(std::move(procedure.blocks[i]));
+		}
+		
+		for (auto &block: blocks) {
+			block.terminator.target = index[block.terminator.target];
+			block.terminator.otherwise = index[block.terminator.otherwise];
+		}
+		procedure.blocks = std::move(blocks);
+	}
+	
+	void PropagateConstants(std::unordered_map<std::string, Procedure> &ir) {
+		for (auto &[name, procedure]: ir) PropagateConstants(procedure);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ir.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace Compiler::IR {
+	
+	/* NOTE Tracks which registers hold a known constant at every point of a
+	 * procedure, following the control flow through loops until it settles.
+	 * Nothing is known on entry, since procedures share registers with their
+	 * callers, and a call forgets everything.
+	 *
+	 * Arithmetic on known values becomes a move of the result, known registers
+	 * read by arithmetic and conditions become immediates, and branches whose
+	 * outcome is known become jumps. Blocks that can no longer be reached are
+	 * dropped.
+	 */
+	void PropagateConstants(Procedure &procedure);
+	
+	void PropagateConstants(std::unordered_map<std::string, Procedure> &ir);
+}
@@ -0,0 +1,289 @@
+#include "ranges.h"
+#include "liveness.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace Compiler::IR {
+	
+	struct Range {
+		int64_t lo;
+		int64_t hi;
+	};
+	
+	constexpr Range FULL{INT64_MIN, INT64_MAX};
+	
+	// The bounds of every register at some point, indexed by its encoding.
+	using Ranges = std::array<Range, 16>;
+	
+	bool operator==(const Range &a, const Range &b) {
+		return a.lo == b.lo && a.hi == b.hi;
+	}
+	
+	Range Join(const Range &a, const Range &b) {
+		return Range{std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+	}
+	
+	/* NOTE A bound that moved jumps to the next threshold past it. Stopping at
+	 * 0 and 2^32 - 1 first keeps a counter that is widened still far enough
+	 * from the limits that adding to it doesn't overflow.
+	 */
+	Range Widen(const Range &old, const Range &next) {
+		Range result = old;
+		if (next.lo < old.lo) result.lo = next.lo >= 0 ? 0 : INT64_MIN;
+		if (next.hi > old.hi) result.hi = next.hi <= UINT32_MAX ? UINT32_MAX : INT64_MAX;
+		return result;
+	}
+	
+	Range RangeOf(const Ranges &ranges, const Value &value) {
+		if (value.tag == OperandTag::Immediate) return Range{value.value, value.value};
+		return ranges[static_cast<uint8_t>(value.reg)];
+	}
+	
+	// The smallest 2^n - 1 that is at least value, which must not be negative.
+	int64_t LowMask(const int64_t value) {
+		int64_t mask = 0;
+		while (mask < value) mask = mask * 2 + 1;
+		return mask;
+	}
+	
+	// Any result that might wrap around gives the full range.
+	Range Evaluate(const Operation op, const Range &a, const Range &b) {
+		switch (op) {
+			case Operation::Add: {
+				Range result;
+				if (__builtin_add_overflow(a.lo, b.lo, &result.lo) || __builtin_add_overflow(a.hi, b.hi, &result.hi)) return FULL;
+				return result;
+			}
+			case Operation::Sub: {
+				Range result;
+				if (__builtin_sub_overflow(a.lo, b.hi, &result.lo) || __builtin_sub_overflow(a.hi, b.lo, &result.hi)) return FULL;
+				return result;
+			}
+			case Operation::Mul: {
+				int64_t products[4];
+				if (__builtin_mul_overflow(a.lo, b.lo, &products[0]) || __builtin_mul_overflow(a.lo, b.hi, &products[1])
+				    || __builtin_mul_overflow(a.hi, b.lo, &products[2]) || __builtin_mul_overflow(a.hi, b.hi, &products[3])) {
+					return FULL;
+				}
+				return Range{*std::min_element(products, products + 4), *std::max_element(products, products + 4)};
+			}
+			case Operation::Div:
+				if (a.lo >= 0 && b.lo >= 1) return Range{a.lo / b.hi, a.hi / b.lo};
+				return FULL;
+			case Operation::Mod:
+				if (a.lo >= 0 && b.lo >= 1) return Range{0, std::min(a.hi, b.hi - 1)};
+				return FULL;
+			case Operation::And:
+				if (a.lo >= 0 && b.lo >= 0) return Range{0, std::min(a.hi, b.hi)};
+				if (a.lo >= 0) return Range{0, a.hi};
+				if (b.lo >= 0) return Range{0, b.hi};
+				return FULL;
+			case Operation::Or:
+			case Operation::Xor:
+				if (a.lo >= 0 && b.lo >= 0) return Range{0, LowMask(std::max(a.hi, b.hi))};
+				return FULL;
+		}
+		return FULL;
+	}
+	
+	bool IsNarrow(const Range &dividend, const Range &divisor) {
+		return dividend.lo >= 0 && dividend.hi <= UINT32_MAX && divisor.lo >= 1 && divisor.hi <= UINT32_MAX;
+	}
+	
+	Comparison Negate(const Comparison comp) {
+		switch (comp) {
+			case Comparison::LessThan: return Comparison::GreaterEquals;
+			case Comparison::LessEquals: return Comparison::GreaterThan;
+			case Comparison::GreaterThan: return Comparison::LessEquals;
+			case Comparison::GreaterEquals: return Comparison::LessThan;
+			case Comparison::Equals: return Comparison::NotEquals;
+			case Comparison::NotEquals: return Comparison::Equals;
+		}
+		return comp;
+	}
+	
+	/* NOTE Narrows the ranges to what they must be when the condition has the
+	 * given outcome. Returns false when that outcome is impossible, so the edge
+	 * is never taken.
+	 */
+	bool Refine(Ranges &ranges, const Condition &condition, const bool holds) {
+		const Range a0 = RangeOf(ranges, condition.a);
+		const Range b0 = RangeOf(ranges, condition.b);
+		Range a = a0;
+		Range b = b0;
+		switch (holds ? condition.comp : Negate(condition.comp)) {
+			case Comparison::LessThan:
+				if (b0.hi == INT64_MIN || a0.lo == INT64_MAX) return false;
+				a.hi = std::min(a.hi, b0.hi - 1);
+				b.lo = std::max(b.lo, a0.lo + 1);
+				break;
+			case Comparison::LessEquals:
+				a.hi = std::min(a.hi, b0.hi);
+				b.lo = std::max(b.lo, a0.lo);
+				break;
+			case Comparison::GreaterThan:
+				if (b0.lo == INT64_MAX || a0.hi == INT64_MIN) return false;
+				a.lo = std::max(a.lo, b0.lo + 1);
+				b.hi = std::min(b.hi, a0.hi - 1);
+				break;
+			case Comparison::GreaterEquals:
+				a.lo = std::max(a.lo, b0.lo);
+				b.hi = std::min(b.hi, a0.hi);
+				break;
+			case Comparison::Equals:
+				a = b = Range{std::max(a0.lo, b0.lo), std::min(a0.hi, b0.hi)};
+				break;
+			case Comparison::NotEquals:
+				// Only a single excluded value at either end of the other range tells anything.
+				if (b0.lo == b0.hi) {
+					if (a.lo == b0.lo && a.lo != INT64_MAX) a.lo += 1;
+					else if (a.hi == b0.lo && a.hi != INT64_MIN) a.hi -= 1;
+				}
+				if (a0.lo == a0.hi) {
+					if (b.lo == a0.lo && b.lo != INT64_MAX) b.lo += 1;
+					else if (b.hi == a0.lo && b.hi != INT64_MIN) b.hi -= 1;
+				}
+				break;
+		}
+		if (a.lo > a.hi || b.lo > b.hi) return false;
+		
+		if (condition.a.tag == OperandTag::Register) ranges[static_cast<uint8_t>(condition.a.reg)] = a;
+		if (condition.b.tag == OperandTag::Register) ranges[static_cast<uint8_t>(condition.b.reg)] = b;
+		return true;
+	}
+	
+	// Runs the instructions of a block, marking its narrow divisions when annotate is set.
+	void Transfer(Block &block, Ranges &ranges, const bool annotate) {
+		for (auto &instruction: block.instructions) {
+			switch (instruction.tag) {
+				case InstructionTag::Move: ranges[static_cast<uint8_t>(instruction.dest)] = RangeOf(ranges, instruction.a);
+					break;
+				case InstructionTag::Binary: {
+					const Range a = RangeOf(ranges, instruction.a);
+					const Range b = RangeOf(ranges, instruction.b);
+					if (annotate && (instruction.op == Operation::Div || instruction.op == Operation::Mod)) instruction.narrow = IsNarrow(a, b);
+					ranges[static_cast<uint8_t>(instruction.dest)] = Evaluate(instruction.op, a, b);
+					break;
+				}
+				case InstructionTag::DivMod: {
+					const Range a = RangeOf(ranges, instruction.a);
+					const Range b = RangeOf(ranges, instruction.b);
+					if (annotate) instruction.narrow = IsNarrow(a, b);
+					ranges[static_cast<uint8_t>(instruction.dest)] = Evaluate(Operation::Div, a, b);
+					ranges[static_cast<uint8_t>(instruction.remainder)] = Evaluate(Operation::Mod, a, b);
+					break;
+				}
+				case InstructionTag::Statement: {
+					const RegisterSet writes = StatementWrites(*instruction.statement);
+					for (uint8_t i = 0; i < 16; ++i) {
+						if (writes & (1u << i)) ranges[i] = FULL;
+					}
+					break;
+				}
+			}
+		}
+	}
+	
+	// Calls visit with every successor of the block that can be reached from out, and the ranges on the way there.
+	template<typename Visit>
+	void ForEachEdge(const Terminator &terminator, const Ranges &out, const Visit &visit) {
+		switch (terminator.tag) {
+			case TerminatorTag::Jump: visit(terminator.target, out);
+				break;
+			case TerminatorTag::Branch: {
+				Ranges taken = out;
+				if (Refine(taken, terminator.condition, true)) visit(terminator.target, taken);
+				Ranges other = out;
+				if (Refine(other, terminator.condition, false)) visit(terminator.otherwise, other);
+				break;
+			}
+			case TerminatorTag::Return: break;
+		}
+	}
+	
+	void AnalyzeRanges(Procedure &procedure) {
+		// Joins over a back edge before the bounds there are widened
+		constexpr size_t WIDEN_AFTER = 4;
+		constexpr size_t NARROW_ROUNDS = 2;
+		
+		const size_t count = procedure.blocks.size();
+		std::vector<Ranges> in(count);
+		std::vector<bool> reached(count, false);
+		std::vector<size_t> updates(count, 0);
+		
+		in[0].fill(FULL);
+		reached[0] = true;
+		std::vector<size_t> worklist{0};
+		
+		// Blocks are laid out in source order, so every loop goes back to a block at or before the one it leaves.
+		// Widening only there leaves the bounds refined by a loop's condition intact inside it.
+		const auto propagate = [&](const size_t from, const size_t successor, const Ranges &ranges) {
+			if (!reached[successor]) {
+				in[successor] = ranges;
+				reached[successor] = true;
+				worklist.push_back(successor);
+				return;
+			}
+			
+			Ranges merged;
+			for (size_t i = 0; i < merged.size(); ++i) merged[i] = Join(in[successor][i], ranges[i]);
+			if (merged == in[successor]) return;
+			
+			if (successor <= from && ++updates[successor] > WIDEN_AFTER) {
+				for (size_t i = 0; i < merged.size(); ++i) merged[i] = Widen(in[successor][i], merged[i]);
+			}
+			in[successor] = merged;
+			worklist.push_back(successor);
+		};
+		
+		while (!worklist.empty()) {
+			const size_t index = worklist.back();
+			worklist.pop_back();
+			
+			Ranges out = in[index];
+			Transfer(procedure.blocks[index], out, false);
+			ForEachEdge(procedure.blocks[index].terminator, out, [&](const size_t successor, const Ranges &ranges) { propagate(index, successor, ranges); });
+		}
+		
+		/* NOTE A widened loop head has lost the bounds its edges had, so inside
+		 * a rotated loop the counter would be unbounded. Recomputing every block
+		 * from its predecessors alone, without the bounds it had, takes them back
+		 * in. Each round starts from ranges that hold on every path, so the next
+		 * ones do as well.
+		 */
+		for (size_t round = 0; round < NARROW_ROUNDS; ++round) {
+			std::vector<Ranges> next(count);
+			std::vector<bool> seen(count, false);
+			next[0].fill(FULL);
+			seen[0] = true;
+			
+			for (size_t i = 0; i < count; ++i) {
+				if (!reached[i]) continue;
+				
+				Ranges out = in[i];
+				Transfer(procedure.blocks[i], out, false);
+				ForEachEdge(procedure.blocks[i].terminator, out, [&](const size_t successor, const Ranges &ranges) {
+					if (!seen[successor]) next[successor] = ranges;
+					else {
+						for (size_t r = 0; r < ranges.size(); ++r) next[successor][r] = Join(next[successor][r], ranges[r]);
+					}
+					seen[successor] = true;
+				});
+			}
+			
+			for (size_t i = 0; i < count; ++i) {
+				if (seen[i]) in[i] = next[i];
+			}
+		}
+		
+		for (size_t i = 0; i < count; ++i) {
+			if (reached[i]) Transfer(procedure.blocks[i], in[i], true);
+		}
+	}
+	
+	void AnalyzeRanges(std::unordered_map<std::string, Procedure> &ir) {
+		for (auto &[name, procedure]: ir) AnalyzeRanges(procedure);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ir.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace Compiler::IR {
+	
+	/* NOTE Tracks the range of values every register may hold, following the
+	 * control flow like constant propagation does. Branch conditions narrow
+	 * the ranges on each edge, so a loop counter is bounded inside the loop by
+	 * the loop's condition. Bounds that keep growing at a loop head are widened
+	 * after a few rounds, so loops settle.
+	 *
+	 * Nothing changes in the code. Divisions whose dividend and divisor are
+	 * both known to fit in 32 unsigned bits, with a nonzero divisor, are
+	 * marked narrow so they can use a 32-bit divide.
+	 */
+	void AnalyzeRanges(Procedure &procedure);
+	
+	void AnalyzeRanges(std::unordered_map<std::string, Procedure> &ir);
+}
@@ -5,15 +5,622 @@ namespace Runtime {
 	
 	bool Options::flag_dumpTokens = false;
 	bool Options::flag_dumpAst = false;
+	bool Options::flag_dumpIr = false;
 	bool Options::flag_dumpCode = false;
 	bool Options::flag_noExec = false;
+	size_t Options::outputBufferSize = 1 << 20;
+	bool Options::flag_inlinePrint = true;
+	size_t Options::inputBufferSize = 1 << 20;
+	const char *Options::outputPath = nullptr;
+	bool Options::flag_freestanding = false;
+	size_t Options::stackSize = 64 << 20;
+	bool Options::flag_hugeStack = false;
+	size_t Options::arenaSize = size_t{16} << 30;
+	int Options::optimizationLevel = 1;
+	
+	OutputBuffer output = {nullptr, nullptr, nullptr, -1, 0};
+	Arena arena = {nullptr, nullptr, nullptr, nullptr};
+	InputBuffer input = {nullptr, nullptr, nullptr, 0, false, false};
+	
+	const char DIGIT_PAIRS[201] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+	
+	unsigned char *WriteDecimal(const int64_t value, unsigned char *out) {
+		uint64_t abs = static_cast<uint64_t>(value);
+		if (value < 0) {
+			*out++ = '-';
+			abs = 0 - abs;
+		}
+		
+		unsigned char digits[MAX_DECIMAL_LENGTH];
+		unsigned char *const digitsEnd = digits + MAX_DECIMAL_LENGTH;
+		unsigned char *ptr = digitsEnd;
+		
+		while (abs >= 100) {
+			const uint64_t pair = abs % 100;
+			abs /= 100;
+			ptr -= 2;
+			memcpy(ptr, &DIGIT_PAIRS[pair * 2], 2);
+		}
+		
+		if (abs >= 10) {
+			ptr -= 2;
+			memcpy(ptr, &DIGIT_PAIRS[abs * 2], 2);
+		}
+		else {
+			*--ptr = static_cast<unsigned char>('0' + abs);
+		}
+		
+		const auto length = static_cast<size_t>(digitsEnd - ptr);
+		memcpy(out, ptr, length);
+		return out + length;
+	}
+	
+	void WriteAll(const int fd, const unsigned char *data, size_t length) {
+		while (length > 0) {
+			const ssize_t written = write(fd, data, length);
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				fprintf(stderr, "Writing output failed with errno %d\n", errno);
+				return;
+			}
+			data += written;
+			length -= static_cast<size_t>(written);
+		}
+	}
 	
 	void Print(int64_t value) {
-		printf("%" PRId64, value);
+		if (!output.begin) {
+			printf("%" PRId64, value);
+			return;
+		}
+		
+		if (static_cast<size_t>(output.end - output.cursor) < MAX_DECIMAL_LENGTH) ExtendOutput();
+		output.cursor = WriteDecimal(value, output.cursor);
 	}
 	
 	void Print(const char *text, size_t length) {
-		fwrite(text, 1, length, stdout);
+		if (!output.begin) {
+			fwrite(text, 1, length, stdout);
+			return;
+		}
+		
+		if (length > static_cast<size_t>(output.end - output.cursor)) {
+			if (output.fd != -1) GrowOutputFile(length);
+			else FlushOutput();
+			
+			if (length > static_cast<size_t>(output.end - output.begin)) {
+				WriteAll(STDOUT_FILENO, reinterpret_cast<const unsigned char *>(text), length);
+				return;
+			}
+		}
+		
+		memcpy(output.cursor, text, length);
+		output.cursor += length;
+	}
+	
+	void OpenOutput(const size_t size) {
+		if (size == 0) return;
+		
+		void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Mapping output buffer failed with errno %d, falling back to stdio\n", errno);
+			return;
+		}
+		
+		output.begin = static_cast<unsigned char *>(mem);
+		output.cursor = output.begin;
+		output.end = output.begin + size;
+		output.fd = -1;
+	}
+	
+	bool OpenOutputFile(const char *const path) {
+		const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1) {
+			fprintf(stderr, "Couldn't open output file %s (errno %d)\n", path, errno);
+			return false;
+		}
+		
+		const size_t size = std::max(FILE_CHUNK, Options::outputBufferSize);
+		void *mem = MAP_FAILED;
+		if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+			mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Mapping output file %s failed with errno %d\n", path, errno);
+			close(fd);
+			return false;
+		}
+		
+		output.begin = static_cast<unsigned char *>(mem);
+		output.cursor = output.begin;
+		output.end = output.begin + size;
+		output.fd = fd;
+		return true;
+	}
+	
+	/* NOTE Grows the output file by at least a chunk and at least the given
+	 * number of bytes. The mapping may move. The generated code has nowhere to
+	 * report an error to, so failing to grow ends the program.
+	 */
+	void GrowOutputFile(const size_t minimum) {
+		const auto used = static_cast<size_t>(output.cursor - output.begin);
+		const auto oldSize = static_cast<size_t>(output.end - output.begin);
+		const size_t newSize = oldSize + std::max({FILE_CHUNK, Options::outputBufferSize, minimum});
+		
+		void *mem = MAP_FAILED;
+		if (ftruncate(output.fd, static_cast<off_t>(newSize)) == 0) {
+			mem = mremap(output.begin, oldSize, newSize, MREMAP_MAYMOVE);
+		}
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Growing output file failed with errno %d\n", errno);
+			ftruncate(output.fd, static_cast<off_t>(used));
+			exit(1);
+		}
+		
+		output.begin = static_cast<unsigned char *>(mem);
+		output.cursor = output.begin + used;
+		output.end = output.begin + newSize;
+	}
+	
+	void ExtendOutput() {
+		if (output.fd != -1) GrowOutputFile(0);
+		else FlushOutput();
+	}
+	
+	void FlushOutput() {
+		const auto length = static_cast<size_t>(output.cursor - output.begin);
+		if (length == 0 || output.fd != -1) return;
+		
+		// Anything printed through stdio before execution has to come first.
+		fflush(stdout);
+		WriteAll(STDOUT_FILENO, output.begin, length);
+		output.cursor = output.begin;
+	}
+	
+	void CloseOutput() {
+		if (!output.begin) return;
+		
+		FlushOutput();
+		munmap(output.begin, static_cast<size_t>(output.end - output.begin));
+		
+		if (output.fd != -1) {
+			if (ftruncate(output.fd, static_cast<off_t>(output.cursor - output.begin)) != 0) {
+				fprintf(stderr, "Truncating output file failed with errno %d\n", errno);
+			}
+			close(output.fd);
+		}
+		output = OutputBuffer{nullptr, nullptr, nullptr, -1, 0};
+	}
+	
+	/* NOTE Sets up the descriptor of a freestanding module. The module writes
+	 * the buffer itself, the runtime only provides the memory and the file.
+	 */
+	bool OpenModuleOutput(OutputBuffer &descriptor, const size_t size, const char *const path) {
+		int fd = STDOUT_FILENO;
+		if (path) {
+			fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd == -1) {
+				fprintf(stderr, "Couldn't open output file %s (errno %d)\n", path, errno);
+				return false;
+			}
+		}
+		
+		void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Mapping output buffer failed with errno %d\n", errno);
+			if (path) close(fd);
+			return false;
+		}
+		
+		// Anything printed through stdio before execution has to come first.
+		fflush(stdout);
+		
+		descriptor.begin = static_cast<unsigned char *>(mem);
+		descriptor.cursor = descriptor.begin;
+		descriptor.end = descriptor.begin + size;
+		descriptor.fd = fd;
+		descriptor.error = 0;
+		return true;
+	}
+	
+	bool CloseModuleOutput(OutputBuffer &descriptor) {
+		munmap(descriptor.begin, static_cast<size_t>(descriptor.end - descriptor.begin));
+		if (descriptor.fd != STDOUT_FILENO) close(descriptor.fd);
+		
+		if (descriptor.error != 0) {
+			fprintf(stderr, "Writing output failed with errno %d\n", descriptor.error);
+			return false;
+		}
+		return true;
+	}
+	
+	static const unsigned char *guardBegin;
+	static const unsigned char *guardEnd;
+	
+	void StackOverflowHandler(const int signalNumber, siginfo_t *const info, void *) {
+		const auto *addr = static_cast<const unsigned char *>(info->si_addr);
+		if (addr >= guardBegin && addr < guardEnd) {
+			// Keep what the program printed so far, only async-signal-safe calls here.
+			const auto length = static_cast<size_t>(output.cursor - output.begin);
+			if (output.fd != -1) ftruncate(output.fd, static_cast<off_t>(length));
+			else if (length != 0) write(STDOUT_FILENO, output.begin, length);
+			
+			constexpr char MESSAGE[] = "Stack overflow in compiled code, see --stack-size\n";
+			write(STDERR_FILENO, MESSAGE, sizeof(MESSAGE) - 1);
+			_exit(1);
+		}
+		
+		// Not ours, crash as usual once the handler returns.
+		signal(signalNumber, SIG_DFL);
+	}
+	
+	bool OpenStack(ExecutionStack &stack, const size_t size, const bool huge) {
+		// With huge pages the top is aligned down to a huge page, which needs some slack.
+		const size_t slack = huge ? HUGE_PAGE_SIZE : 0;
+		const size_t mappingSize = STACK_GUARD_SIZE + size + slack;
+		
+		void *mem = mmap(nullptr, mappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Mapping the stack failed with errno %d\n", errno);
+			return false;
+		}
+		
+		auto *const mapping = static_cast<unsigned char *>(mem);
+		unsigned char *top = mapping + mappingSize;
+		if (huge) top = reinterpret_cast<unsigned char *>(reinterpret_cast<uintptr_t>(top) & ~(HUGE_PAGE_SIZE - 1));
+		unsigned char *const bottom = top - size;
+		
+		if (mprotect(bottom, size, PROT_READ | PROT_WRITE) != 0) {
+			fprintf(stderr, "Protecting the stack failed with errno %d\n", errno);
+			munmap(mem, mappingSize);
+			return false;
+		}
+#ifdef MADV_HUGEPAGE
+		if (huge) madvise(bottom, size, MADV_HUGEPAGE);
+#endif
+		
+		stack = ExecutionStack{mapping, mappingSize, bottom - STACK_GUARD_SIZE, top};
+		guardBegin = stack.guard;
+		guardEnd = bottom;
+		
+		// The handler can't run on the stack that overflowed.
+		static unsigned char signalStack[64 << 10];
+		stack_t alternate{};
+		alternate.ss_sp = signalStack;
+		alternate.ss_size = sizeof(signalStack);
+		sigaltstack(&alternate, nullptr);
+		
+		struct sigaction action{};
+		action.sa_sigaction = &StackOverflowHandler;
+		action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGSEGV, &action, nullptr);
+		return true;
+	}
+	
+	void CloseStack(ExecutionStack &stack) {
+		signal(SIGSEGV, SIG_DFL);
+		guardBegin = nullptr;
+		guardEnd = nullptr;
+		munmap(stack.mapping, stack.mappingSize);
+	}
+	
+	bool OpenArena(Arena &descriptor, const size_t size) {
+		void *mem = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Reserving the arena failed with errno %d\n", errno);
+			return false;
+		}
+		
+		descriptor.begin = static_cast<unsigned char *>(mem);
+		descriptor.cursor = descriptor.begin;
+		descriptor.end = descriptor.begin;
+		descriptor.limit = descriptor.begin + size;
+		return true;
+	}
+	
+	/* NOTE Commits pages until the arena reaches the required address. Like the
+	 * output file, the generated code has nowhere to report failure to.
+	 */
+	void GrowArena(unsigned char *const required) {
+		const size_t used = static_cast<size_t>(required - arena.begin);
+		unsigned char *const newEnd = arena.begin + (used + ARENA_CHUNK - 1) / ARENA_CHUNK * ARENA_CHUNK;
+		
+		if (required < arena.cursor || required > arena.limit) {
+			fprintf(stderr, "Arena is out of space, see --arena-size\n");
+		}
+		else if (mprotect(arena.end, static_cast<size_t>(std::min(newEnd, arena.limit) - arena.end), PROT_READ | PROT_WRITE) != 0) {
+			fprintf(stderr, "Growing the arena failed with errno %d\n", errno);
+		}
+		else {
+			arena.end = std::min(newEnd, arena.limit);
+			return;
+		}
+		
+		CloseOutput();
+		exit(1);
+	}
+	
+	void CloseArena(Arena &descriptor) {
+		munmap(descriptor.begin, static_cast<size_t>(descriptor.limit - descriptor.begin));
+		descriptor = Arena{nullptr, nullptr, nullptr, nullptr};
+	}
+	
+	// Memory for the runtime's own structures, taken from the same arena as alloc statements.
+	static void *ArenaAllocate(const size_t size) {
+		unsigned char *const block = arena.cursor;
+		unsigned char *const next = block + (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+		if (next > arena.end) GrowArena(next);
+		arena.cursor = next;
+		return block;
+	}
+	
+	static void AllocateSlots(HashTable &table, const size_t capacity) {
+		table.control = static_cast<uint8_t *>(ArenaAllocate(capacity));
+		table.slots = static_cast<TableSlot *>(ArenaAllocate(capacity * sizeof(TableSlot)));
+		table.mask = capacity - 1;
+		table.count = 0;
+		memset(table.control, TABLE_EMPTY, capacity);
+	}
+	
+	static uint64_t HashKey(const int64_t key) {
+		uint64_t hash = static_cast<uint64_t>(key);
+		hash ^= hash >> 33;
+		hash *= UINT64_C(0x9E3779B97F4A7C15);
+		return hash ^ (hash >> 29);
+	}
+	
+	/* NOTE Returns the slot holding key, or the empty slot it would go to, with
+	 * found telling them apart. The table always has an empty slot, so probing
+	 * ends.
+	 */
+	static size_t ProbeTable(const HashTable &table, const int64_t key, bool &found) {
+		const uint64_t hash = HashKey(key);
+		const auto tag = static_cast<char>(hash >> 57);
+		const __m128i tags = _mm_set1_epi8(tag);
+		
+		for (size_t group = hash & table.mask & ~(TABLE_GROUP - 1);; group = (group + TABLE_GROUP) & table.mask) {
+			const __m128i control = _mm_load_si128(reinterpret_cast<const __m128i *>(table.control + group));
+			
+			for (auto matches = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(control, tags))); matches != 0; matches &= matches - 1) {
+				const size_t slot = group + static_cast<size_t>(__builtin_ctz(matches));
+				if (table.slots[slot].key == key) {
+					found = true;
+					return slot;
+				}
+			}
+			
+			const auto empty = static_cast<unsigned>(_mm_movemask_epi8(control));
+			if (empty != 0) {
+				found = false;
+				return group + static_cast<size_t>(__builtin_ctz(empty));
+			}
+		}
+	}
+	
+	// Finds the slot for key, claiming an empty one and growing the table at 7/8 load if needed.
+	static TableSlot &ClaimSlot(HashTable &table, const int64_t key, bool &found) {
+		size_t slot = ProbeTable(table, key, found);
+		if (found) return table.slots[slot];
+		
+		if ((table.count + 1) * 8 > (table.mask + 1) * 7) {
+			const HashTable old = table;
+			AllocateSlots(table, (old.mask + 1) * 2);
+			for (size_t i = 0; i <= old.mask; ++i) {
+				if (old.control[i] == TABLE_EMPTY) continue;
+				bool moved;
+				const size_t to = ProbeTable(table, old.slots[i].key, moved);
+				table.control[to] = old.control[i];
+				table.slots[to] = old.slots[i];
+			}
+			table.count = old.count;
+			slot = ProbeTable(table, key, found);
+		}
+		
+		table.control[slot] = static_cast<uint8_t>(HashKey(key) >> 57);
+		table.slots[slot] = TableSlot{key, 0};
+		table.count += 1;
+		return table.slots[slot];
+	}
+	
+	HashTable *NewTable() {
+		auto *const table = static_cast<HashTable *>(ArenaAllocate(sizeof(HashTable)));
+		AllocateSlots(*table, TABLE_INITIAL_CAPACITY);
+		return table;
+	}
+	
+	void TableInsert(HashTable *const table, const int64_t key, const int64_t value) {
+		bool found;
+		ClaimSlot(*table, key, found).value = value;
+	}
+	
+	int64_t TableLookup(HashTable *const table, const int64_t key) {
+		bool found;
+		const size_t slot = ProbeTable(*table, key, found);
+		return found ? table->slots[slot].value : 0;
+	}
+	
+	int64_t TableIncrement(HashTable *const table, const int64_t key, const int64_t amount) {
+		bool found;
+		TableSlot &slot = ClaimSlot(*table, key, found);
+		// Wraps around like the generated code's arithmetic.
+		slot.value = static_cast<int64_t>(static_cast<uint64_t>(slot.value) + static_cast<uint64_t>(amount));
+		return slot.value;
+	}
+	
+	static std::vector<MappedFile> mappedFiles;
+	
+	MappedFile MapFile(const char *const path) {
+		const int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd == -1) {
+			fprintf(stderr, "Couldn't open %s (errno %d)\n", path, errno);
+			return MappedFile{nullptr, -1};
+		}
+		
+		const off_t size = lseek(fd, 0, SEEK_END);
+		if (size <= 0) {
+			if (size < 0) fprintf(stderr, "Couldn't get the size of %s (errno %d)\n", path, errno);
+			close(fd);
+			return MappedFile{nullptr, size < 0 ? -1 : 0};
+		}
+		
+		void *mem = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		close(fd);
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Mapping %s failed with errno %d\n", path, errno);
+			return MappedFile{nullptr, -1};
+		}
+#ifdef MADV_HUGEPAGE
+		madvise(mem, static_cast<size_t>(size), MADV_HUGEPAGE); // Only a hint, fails on most file systems
+#endif
+		
+		const MappedFile file{static_cast<const unsigned char *>(mem), size};
+		mappedFiles.push_back(file);
+		return file;
+	}
+	
+	void UnmapFiles() {
+		for (const MappedFile &file: mappedFiles) {
+			munmap(const_cast<unsigned char *>(file.data), static_cast<size_t>(file.length));
+		}
+		mappedFiles.clear();
+	}
+	
+	/* NOTE Moves unread data to the front of the buffer and reads more after it.
+	 * Returns false once stdin is exhausted.
+	 */
+	bool FillInput() {
+		if (input.eof) return false;
+		
+		const auto remaining = static_cast<size_t>(input.end - input.cursor);
+		memmove(input.begin, input.cursor, remaining);
+		input.cursor = input.begin;
+		input.end = input.begin + remaining;
+		
+		// Don't keep a prompt in the output buffer while waiting for the user.
+		if (input.interactive) FlushOutput();
+		
+		ssize_t count;
+		do {
+			count = read(STDIN_FILENO, input.end, input.capacity - remaining);
+		} while (count < 0 && errno == EINTR);
+		
+		if (count <= 0) {
+			if (count < 0) fprintf(stderr, "Reading input failed with errno %d\n", errno);
+			memset(input.end, 0, INPUT_PADDING);
+			input.eof = true;
+			return false;
+		}
+		
+		input.end += count;
+		memset(input.end, 0, INPUT_PADDING);
+		return true;
+	}
+	
+	bool IsDigit(const unsigned char c) {
+		return c >= '0' && c <= '9';
+	}
+	
+	// Length of the run of digits at ptr, 16 bytes per step.
+	size_t CountDigits(const unsigned char *const ptr) {
+		const __m128i belowDigits = _mm_set1_epi8('0' - 1);
+		const __m128i aboveDigits = _mm_set1_epi8('9' + 1);
+		
+		size_t count = 0;
+		while (true) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + count));
+			const __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, belowDigits), _mm_cmplt_epi8(chunk, aboveDigits));
+			const auto mask = static_cast<unsigned>(_mm_movemask_epi8(digits));
+			
+			if (mask != 0xFFFF) return count + static_cast<size_t>(__builtin_ctz(~mask));
+			count += 16;
+		}
+	}
+	
+	// Converts 8 ASCII digits at once, most significant digit first in memory.
+	uint64_t ParseEightDigits(const unsigned char *const ptr) {
+		uint64_t val;
+		memcpy(&val, ptr, 8);
+		
+		val -= UINT64_C(0x3030303030303030);
+		val = (val * 10) + (val >> 8);
+		val = (((val & UINT64_C(0x000000FF000000FF)) * UINT64_C(0x000F424000000064))
+		       + (((val >> 16) & UINT64_C(0x000000FF000000FF)) * UINT64_C(0x0000271000000001))) >> 32;
+		return val;
+	}
+	
+	/* NOTE Parses the next integer on stdin, skipping everything that isn't a
+	 * digit or a minus sign followed by a digit. Returns current once the input
+	 * is exhausted. Values that don't fit in 64 bits wrap around.
+	 */
+	int64_t ReadInteger(const int64_t current) {
+		if (!input.begin) return current;
+		
+		bool negative = false;
+		while (true) {
+			while (input.cursor < input.end && !IsDigit(*input.cursor) && *input.cursor != '-') ++input.cursor;
+			
+			if (input.end - input.cursor < 2 && !input.eof) {
+				FillInput();
+				continue;
+			}
+			if (input.cursor == input.end) return current;
+			
+			if (IsDigit(*input.cursor)) break;
+			
+			input.cursor += 1;
+			if (input.cursor < input.end && IsDigit(*input.cursor)) {
+				negative = true;
+				break;
+			}
+		}
+		
+		uint64_t value = 0;
+		while (true) {
+			size_t count = CountDigits(input.cursor);
+			const unsigned char *ptr = input.cursor;
+			input.cursor += count;
+			
+			for (; count >= 8; count -= 8, ptr += 8) value = value * 100000000 + ParseEightDigits(ptr);
+			for (; count > 0; --count, ++ptr) value = value * 10 + (*ptr - '0');
+			
+			// The number might continue past the data read so far.
+			if (input.cursor < input.end || !FillInput()) break;
+		}
+		
+		return static_cast<int64_t>(negative ? 0 - value : value);
+	}
+	
+	void OpenInput(const size_t size) {
+		void *mem = mmap(nullptr, size + INPUT_PADDING, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			fprintf(stderr, "Mapping input buffer failed with errno %d\n", errno);
+			return;
+		}
+		
+		input.begin = static_cast<unsigned char *>(mem);
+		input.cursor = input.begin;
+		input.end = input.begin;
+		input.capacity = size;
+		input.eof = false;
+		input.interactive = isatty(STDIN_FILENO);
+	}
+	
+	void CloseInput() {
+		if (!input.begin) return;
+		
+		munmap(input.begin, input.capacity + INPUT_PADDING);
+		input = InputBuffer{nullptr, nullptr, nullptr, 0, false, false};
 	}
 	
 	int RunFile(char *filepath) {
@@ -41,16 +648,32 @@ namespace Runtime {
 		
 		if (Options::flag_dumpAst) PrintParseResults(filepath, procedures);
 		
+		std::unordered_map<std::string, Compiler::IR::Procedure> ir;
+		error = Compiler::IR::Build(procedures, ir);
+		if (error) {
+			fprintf(stderr, "%s:%zu:%zu: Compiler error: %s\n", filepath, error.pos.line, error.pos.col, error.message.c_str());
+			return 1;
+		}
+		
+		if (Options::optimizationLevel >= 1) {
+			Compiler::IR::PropagateConstants(ir);
+			Compiler::IR::AnalyzeRanges(ir);
+		}
+		if (Options::flag_dumpIr) PrintIR(filepath, ir);
+		
 		std::basic_string<unsigned char> machineCode;
 		size_t entry;
-		error = Compiler::Compile(procedures, machineCode, entry);
+		size_t rodataPtr;
+		size_t dataPtr;
+		std::vector<Compiler::PeepholeStats> peephole;
+		error = Compiler::Compile(procedures, ir, machineCode, entry, rodataPtr, dataPtr, peephole);
 		if (error) {
 			fprintf(stderr, "%s:%zu:%zu: Compiler error: %s\n", filepath, error.pos.line, error.pos.col, error.message.c_str());
 			return 1;
 		}
 		
-		if (Options::flag_dumpCode) PrintCompileResults(machineCode, entry);
-		if (!Options::flag_noExec) ExecuteCompileResults(machineCode, entry);
+		if (Options::flag_dumpCode) PrintCompileResults(machineCode, entry, rodataPtr, dataPtr, peephole);
+		if (!Options::flag_noExec && !ExecuteCompileResults(machineCode, entry, rodataPtr, dataPtr)) return 1;
 		
 		return 0;
 	}
@@ -122,28 +745,56 @@ namespace Runtime {
 					break;
 				case Lexer::TokenTag::RegXmm15: std::cout << "RegXmm15";
 					break;
+				case Lexer::TokenTag::KeyAlloc: std::cout << "KeyAlloc";
+					break;
 				case Lexer::TokenTag::KeyBranch: std::cout << "KeyBranch";
 					break;
 				case Lexer::TokenTag::KeyBreak: std::cout << "KeyBreak";
 					break;
+				case Lexer::TokenTag::KeyCompare: std::cout << "KeyCompare";
+					break;
 				case Lexer::TokenTag::KeyContinue: std::cout << "KeyContinue";
 					break;
+				case Lexer::TokenTag::KeyCopy: std::cout << "KeyCopy";
+					break;
+				case Lexer::TokenTag::KeyDivmod: std::cout << "KeyDivmod";
+					break;
 				case Lexer::TokenTag::KeyElse: std::cout << "KeyElse";
 					break;
+				case Lexer::TokenTag::KeyFill: std::cout << "KeyFill";
+					break;
+				case Lexer::TokenTag::KeyFind: std::cout << "KeyFind";
+					break;
 				case Lexer::TokenTag::KeyIf: std::cout << "KeyIf";
 					break;
+				case Lexer::TokenTag::KeyIncrement: std::cout << "KeyIncrement";
+					break;
+				case Lexer::TokenTag::KeyInsert: std::cout << "KeyInsert";
+					break;
+				case Lexer::TokenTag::KeyLookup: std::cout << "KeyLookup";
+					break;
 				case Lexer::TokenTag::KeyLoop: std::cout << "KeyLoop";
 					break;
 				case Lexer::TokenTag::KeyMacro: std::cout << "KeyMacro";
 					break;
+				case Lexer::TokenTag::KeyMapfile: std::cout << "KeyMapfile";
+					break;
 				case Lexer::TokenTag::KeyPop: std::cout << "KeyPop";
 					break;
 				case Lexer::TokenTag::KeyProc: std::cout << "KeyProc";
 					break;
 				case Lexer::TokenTag::KeyPush: std::cout << "KeyPush";
 					break;
+				case Lexer::TokenTag::KeyRdtsc: std::cout << "KeyRdtsc";
+					break;
+				case Lexer::TokenTag::KeyRdtscp: std::cout << "KeyRdtscp";
+					break;
+				case Lexer::TokenTag::KeyReset: std::cout << "KeyReset";
+					break;
 				case Lexer::TokenTag::KeyReturn: std::cout << "KeyReturn";
 					break;
+				case Lexer::TokenTag::KeyTable: std::cout << "KeyTable";
+					break;
 				case Lexer::TokenTag::KeyVal: std::cout << "KeyVal";
 					break;
 				case Lexer::TokenTag::KeyVar: std::cout << "KeyVar";
@@ -240,186 +891,520 @@ namespace Runtime {
 		}
 	}
 	
-	void PrintCompileResults(const std::basic_string<unsigned char> &machineCode, const size_t entry) {
+	void PrintIR(const std::string_view filePrefix, const std::unordered_map<std::string, Compiler::IR::Procedure> &ir) {
+		for (const auto &[name, procedure]: ir) {
+			std::cout << "PROCEDURE " << name << "\n\n";
+			
+			for (size_t i = 0; i < procedure.blocks.size(); ++i) {
+				const auto &block = procedure.blocks[i];
+				std::cout << 'b' << i << ':';
+				if (block.loopHead) std::cout << " (loop head)";
+				std::cout << '\n';
+				
+				for (const auto &instruction: block.instructions) {
+					switch (instruction.tag) {
+						case Compiler::IR::InstructionTag::Move:
+							std::cout << "\tMove ";
+							PrintRegister(instruction.dest);
+							std::cout << " = ";
+							PrintValue(instruction.a);
+							std::cout << '\n';
+							break;
+						case Compiler::IR::InstructionTag::Binary:
+							std::cout << "\tBinary ";
+							PrintRegister(instruction.dest);
+							std::cout << " = ";
+							PrintValue(instruction.a);
+							std::cout << ' ';
+							PrintOperation(instruction.op);
+							std::cout << ' ';
+							PrintValue(instruction.b);
+							if (instruction.narrow) std::cout << " (32-bit)";
+							std::cout << '\n';
+							break;
+						case Compiler::IR::InstructionTag::DivMod:
+							std::cout << "\tDivMod ";
+							PrintRegister(instruction.dest);
+							std::cout << ", ";
+							PrintRegister(instruction.remainder);
+							std::cout << " = ";
+							PrintValue(instruction.a);
+							std::cout << " divmod ";
+							PrintValue(instruction.b);
+							if (instruction.narrow) std::cout << " (32-bit)";
+							std::cout << '\n';
+							break;
+						case Compiler::IR::InstructionTag::Statement: PrintStatement(filePrefix, *instruction.statement, 1, false);
+							break;
+					}
+				}
+				
+				const auto &terminator = block.terminator;
+				switch (terminator.tag) {
+					case Compiler::IR::TerminatorTag::Jump: std::cout << "\tJump b" << terminator.target << '\n';
+						break;
+					case Compiler::IR::TerminatorTag::Branch:
+						std::cout << "\tBranch (";
+						PrintCondition(terminator.condition);
+						std::cout << ") b" << terminator.target << ", else b" << terminator.otherwise << '\n';
+						break;
+					case Compiler::IR::TerminatorTag::Return: std::cout << "\tReturn\n";
+						break;
+				}
+			}
+			
+			std::cout << '\n';
+		}
+	}
+	
+	void PrintCompileResults(const std::basic_string<unsigned char> &machineCode, const size_t entry, const size_t rodataPtr, const size_t dataPtr, const std::vector<Compiler::PeepholeStats> &peephole) {
 		printf("Entry point is at 0x%016zX\n", entry);
-		printf(
-				"Runtime library function would be at:\n"
-				"\t0x%016zX: void RtPrint(int64_t)\n"
-				"\t0x%016zX: void RtPrint(const char*, size_t)\n",
-				(size_t) (void (*)(int64_t)) (&Runtime::Print),
-				(size_t) (void (*)(const char *, size_t)) (&Runtime::Print)
-		);
+		printf("Read-only data is at 0x%016zX\n", rodataPtr);
+		printf("Writable data is at 0x%016zX\n", dataPtr);
+		if (!Options::flag_freestanding) {
+			printf(
+					"Runtime library function would be at:\n"
+					"\t0x%016zX: void RtPrint(int64_t)\n"
+					"\t0x%016zX: void RtPrint(const char*, size_t)\n"
+					"\t0x%016zX: void RtExtendOutput()\n"
+					"Output buffer descriptor is at 0x%016zX\n",
+					(size_t) (void (*)(int64_t)) (&Runtime::Print),
+					(size_t) (void (*)(const char *, size_t)) (&Runtime::Print),
+					(size_t) (&Runtime::ExtendOutput),
+					(size_t) (&Runtime::output)
+			);
+		}
 		
-		for (const unsigned char c: machineCode) {
-			printf("%02X ", c);
+		if (!peephole.empty()) puts("Peephole pass:");
+		for (const auto &stats: peephole) {
+			if (stats.skipped) printf("\t%s: skipped, %zu bytes\n", stats.procedure.c_str(), stats.bytes);
+			else {
+				printf(
+						"\t%s: removed %zu of %zu instructions, %zu of %zu bytes, %zu short branches\n",
+						stats.procedure.c_str(), stats.removedInstructions, stats.instructions, stats.removedBytes, stats.bytes, stats.shortBranches
+				);
+			}
+		}
+		
+		for (size_t i = 0; i < rodataPtr; i++) {
+			printf("%02X ", machineCode[i]);
 		}
 		
 		puts("");
+		
+		if (rodataPtr < dataPtr) {
+			puts("Read-only data:");
+			for (size_t i = rodataPtr; i < dataPtr; i++) {
+				printf("%02X ", machineCode[i]);
+			}
+			
+			puts("");
+		}
 	}
 	
-	void ExecuteCompileResults(const std::basic_string<unsigned char> &machineCode, size_t entry) {
+	bool ExecuteCompileResults(const std::basic_string<unsigned char> &machineCode, size_t entry, const size_t rodataPtr, const size_t dataPtr) {
 		const size_t len = machineCode.length();
 		void *mem = mmap(nullptr, len, PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 		if (mem == MAP_FAILED) {
 			fprintf(stderr, "Mapping memory failed with errno %d\n", errno);
-			return;
+			return false;
 		}
 		memcpy(mem, machineCode.data(), len);
-		mprotect(mem, len, PROT_EXEC | PROT_READ);
+		mprotect(mem, rodataPtr, PROT_EXEC | PROT_READ);
+		if (rodataPtr < dataPtr) mprotect(static_cast<char *>(mem) + rodataPtr, dataPtr - rodataPtr, PROT_READ);
+		if (dataPtr < len) mprotect(static_cast<char *>(mem) + dataPtr, len - dataPtr, PROT_READ | PROT_WRITE);
 		
 		char *entryPtr = static_cast<char *>(mem) + entry;
-		void (*main)();
+		void (*main)(unsigned char *stackTop);
 		memcpy(&main, &entryPtr, 8);
-		main();
 		
+		ExecutionStack stack;
+		if (!OpenStack(stack, Options::stackSize, Options::flag_hugeStack)) {
+			munmap(mem, len);
+			return false;
+		}
+		
+		if (Options::flag_freestanding) {
+			auto *descriptor = reinterpret_cast<OutputBuffer *>(static_cast<char *>(mem) + dataPtr + Compiler::OUTPUT_DESCRIPTOR_PTR);
+			auto *moduleArena = reinterpret_cast<Arena *>(static_cast<char *>(mem) + dataPtr + Compiler::ARENA_DESCRIPTOR_PTR);
+			bool success = OpenArena(*moduleArena, Options::arenaSize);
+			if (success) {
+				success = OpenModuleOutput(*descriptor, Options::outputBufferSize, Options::outputPath);
+				if (success) {
+					main(stack.top);
+					success = CloseModuleOutput(*descriptor);
+				}
+				CloseArena(*moduleArena);
+			}
+			
+			CloseStack(stack);
+			munmap(mem, len);
+			return success;
+		}
+		
+		if (!OpenArena(arena, Options::arenaSize)) {
+			CloseStack(stack);
+			munmap(mem, len);
+			return false;
+		}
+		if (Options::outputPath) {
+			if (!OpenOutputFile(Options::outputPath)) {
+				CloseArena(arena);
+				CloseStack(stack);
+				munmap(mem, len);
+				return false;
+			}
+		}
+		else {
+			OpenOutput(Options::outputBufferSize);
+		}
+		OpenInput(Options::inputBufferSize);
+		main(stack.top);
+		CloseInput();
+		CloseOutput();
+		UnmapFiles();
+		
+		CloseArena(arena);
+		CloseStack(stack);
 		munmap(mem, len);
+		return true;
 	}
 	
 	void PrintStatements(const std::string_view filePrefix, const std::vector<std::unique_ptr<Parser::Statement>> &statements, const size_t level) {
-		for (const auto &statement: statements) {
-			for (size_t i = 0; i < level; ++i) std::cout << '\t';
-			
-			switch (statement->tag) {
-				case StatementTag::Assignment: {
-					auto stmt = dynamic_cast<Parser::AssignmentStatement *>(statement.get());
-					std::cout << "Assignment ";
-					PrintRegister(stmt->dest);
-					std::cout << " = ";
-					PrintOperand(*stmt->source);
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+		for (const auto &statement: statements) PrintStatement(filePrefix, *statement, level, true);
+	}
+	
+	void PrintStatement(const std::string_view filePrefix, const Parser::Statement &statement, const size_t level, const bool withCondition) {
+		for (size_t i = 0; i < level; ++i) std::cout << '\t';
+		
+		switch (statement.tag) {
+			case StatementTag::Assignment: {
+				auto stmt = dynamic_cast<const Parser::AssignmentStatement *>(&statement);
+				std::cout << "Assignment ";
+				PrintRegister(stmt->dest);
+				std::cout << " = ";
+				PrintOperand(*stmt->source);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
 				}
-				case StatementTag::Shorthand: {
-					auto stmt = dynamic_cast<Parser::ShorthandStatement *>(statement.get());
-					std::cout << "Shorthand ";
-					PrintRegister(stmt->dest);
-					std::cout << ' ';
-					PrintOperation(stmt->op);
-					std::cout << "= ";
-					PrintOperand(*stmt->source);
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Shorthand: {
+				auto stmt = dynamic_cast<const Parser::ShorthandStatement *>(&statement);
+				std::cout << "Shorthand ";
+				PrintRegister(stmt->dest);
+				std::cout << ' ';
+				PrintOperation(stmt->op);
+				std::cout << "= ";
+				PrintOperand(*stmt->source);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Longhand: {
+				auto stmt = dynamic_cast<const Parser::LonghandStatement *>(&statement);
+				std::cout << "Longhand ";
+				PrintRegister(stmt->dest);
+				std::cout << " = ";
+				PrintOperand(*stmt->sourceA);
+				std::cout << ' ';
+				PrintOperation(stmt->op);
+				std::cout << ' ';
+				PrintOperand(*stmt->sourceB);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::DivMod: {
+				auto stmt = dynamic_cast<const Parser::DivModStatement *>(&statement);
+				std::cout << "DivMod ";
+				PrintRegister(stmt->quotient);
+				std::cout << ", ";
+				PrintRegister(stmt->remainder);
+				std::cout << " = ";
+				PrintOperand(*stmt->dividend);
+				std::cout << " divmod ";
+				PrintOperand(*stmt->divisor);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Loop: {
+				auto stmt = dynamic_cast<const Parser::LoopStatement *>(&statement);
+				std::cout << "Loop";
+				if (stmt->condition.has_value()) {
+					std::cout << " (";
+					PrintCondition(*stmt->condition);
+					std::cout << ")";
+				}
+				std::cout << '\n';
+				PrintStatements(filePrefix, stmt->statements, level + 1);
+				return;
+			}
+			case StatementTag::Branch: {
+				auto stmt = dynamic_cast<const Parser::BranchStatement *>(&statement);
+				std::cout << "Branch (";
+				PrintCondition(*stmt->condition);
+				std::cout << ")\n";
+				PrintStatements(filePrefix, stmt->statements, level + 1);
+				std::cout << "Else\n";
+				PrintStatements(filePrefix, stmt->elseBlock, level + 1);
+				return;
+			}
+			case StatementTag::Alloc: {
+				auto stmt = dynamic_cast<const Parser::AllocStatement *>(&statement);
+				std::cout << "Alloc ";
+				PrintRegister(stmt->dest);
+				std::cout << ", ";
+				PrintOperand(*stmt->size);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Copy: {
+				auto stmt = dynamic_cast<const Parser::CopyStatement *>(&statement);
+				std::cout << "Copy [";
+				PrintRegister(stmt->dest);
+				std::cout << "], [";
+				PrintRegister(stmt->source);
+				std::cout << "], ";
+				PrintOperand(*stmt->count);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Fill: {
+				auto stmt = dynamic_cast<const Parser::FillStatement *>(&statement);
+				std::cout << "Fill [";
+				PrintRegister(stmt->dest);
+				std::cout << "], ";
+				PrintOperand(*stmt->count);
+				std::cout << ", ";
+				PrintOperand(*stmt->value);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Compare: {
+				auto stmt = dynamic_cast<const Parser::CompareStatement *>(&statement);
+				std::cout << "Compare ";
+				PrintRegister(stmt->dest);
+				std::cout << ", [";
+				PrintRegister(stmt->a);
+				std::cout << "], [";
+				PrintRegister(stmt->b);
+				std::cout << "], ";
+				PrintOperand(*stmt->count);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Find: {
+				auto stmt = dynamic_cast<const Parser::FindStatement *>(&statement);
+				std::cout << "Find ";
+				PrintRegister(stmt->dest);
+				std::cout << ", [";
+				PrintRegister(stmt->address);
+				std::cout << "], ";
+				PrintOperand(*stmt->count);
+				std::cout << ", ";
+				PrintOperand(*stmt->value);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Table: {
+				auto stmt = dynamic_cast<const Parser::RegisterStatement *>(&statement);
+				std::cout << "Table ";
+				PrintRegister(stmt->reg);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Insert:
+			case StatementTag::Lookup:
+			case StatementTag::Increment: {
+				auto stmt = dynamic_cast<const Parser::TableStatement *>(&statement);
+				if (stmt->tag == StatementTag::Insert) {
+					std::cout << "Insert [";
 				}
-				case StatementTag::Longhand: {
-					auto stmt = dynamic_cast<Parser::LonghandStatement *>(statement.get());
-					std::cout << "Longhand ";
+				else {
+					std::cout << (stmt->tag == StatementTag::Lookup ? "Lookup " : "Increment ");
 					PrintRegister(stmt->dest);
-					std::cout << " = ";
-					PrintOperand(*stmt->sourceA);
-					std::cout << ' ';
-					PrintOperation(stmt->op);
-					std::cout << ' ';
-					PrintOperand(*stmt->sourceB);
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+					std::cout << ", [";
 				}
-				case StatementTag::Loop: {
-					auto stmt = dynamic_cast<Parser::LoopStatement *>(statement.get());
-					std::cout << "Loop";
-					if (stmt->condition.has_value()) {
-						std::cout << " (";
-						PrintCondition(*stmt->condition);
-						std::cout << ")";
-					}
-					std::cout << '\n';
-					PrintStatements(filePrefix, stmt->statements, level + 1);
-					continue;
+				PrintRegister(stmt->table);
+				std::cout << "], ";
+				PrintOperand(*stmt->key);
+				if (stmt->value) {
+					std::cout << ", ";
+					PrintOperand(*stmt->value);
 				}
-				case StatementTag::Branch: {
-					auto stmt = dynamic_cast<Parser::BranchStatement *>(statement.get());
-					std::cout << "Branch (";
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
 					PrintCondition(*stmt->condition);
-					std::cout << ")\n";
-					PrintStatements(filePrefix, stmt->statements, level + 1);
-					std::cout << "Else\n";
-					PrintStatements(filePrefix, stmt->elseBlock, level + 1);
-					continue;
-				}
-				case StatementTag::Break: {
-					std::cout << "Break";
-					if (statement->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*statement->condition);
-					}
-					break;
 				}
-				case StatementTag::Continue: {
-					std::cout << "Continue";
-					if (statement->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*statement->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Rdtsc: {
+				auto stmt = dynamic_cast<const Parser::RegisterStatement *>(&statement);
+				std::cout << "Rdtsc ";
+				PrintRegister(stmt->reg);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
 				}
-				case StatementTag::Return: {
-					std::cout << "Return";
-					if (statement->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*statement->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Rdtscp: {
+				auto stmt = dynamic_cast<const Parser::RegisterPairStatement *>(&statement);
+				std::cout << "Rdtscp ";
+				PrintRegister(stmt->first);
+				std::cout << ", ";
+				PrintRegister(stmt->second);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
 				}
-				case StatementTag::Call: {
-					auto stmt = dynamic_cast<Parser::CallStatement *>(statement.get());
-					std::cout << "Call " << stmt->name;
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Reset: {
+				std::cout << "Reset";
+				if (withCondition && statement.condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*statement.condition);
 				}
-				case StatementTag::Stdout: {
-					auto stmt = dynamic_cast<Parser::StdoutStatement *>(statement.get());
-					std::cout << "Stdout ";
-					PrintOperand(*stmt->source);
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Break: {
+				std::cout << "Break";
+				if (withCondition && statement.condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*statement.condition);
 				}
-				case StatementTag::StdoutText: {
-					auto stmt = dynamic_cast<Parser::StdoutTextStatement *>(statement.get());
-					std::cout << "StdoutText ";
-					std::cout << stmt->text;
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Continue: {
+				std::cout << "Continue";
+				if (withCondition && statement.condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*statement.condition);
 				}
-				case StatementTag::Push: {
-					auto stmt = dynamic_cast<Parser::RegisterStatement *>(statement.get());
-					std::cout << "Push ";
-					PrintRegister(stmt->reg);
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Return: {
+				std::cout << "Return";
+				if (withCondition && statement.condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*statement.condition);
 				}
-				case StatementTag::Pop: {
-					auto stmt = dynamic_cast<Parser::RegisterStatement *>(statement.get());
-					std::cout << "Pop ";
-					PrintRegister(stmt->reg);
-					if (stmt->condition.has_value()) {
-						std::cout << " if ";
-						PrintCondition(*stmt->condition);
-					}
-					break;
+				break;
+			}
+			case StatementTag::Call: {
+				auto stmt = dynamic_cast<const Parser::CallStatement *>(&statement);
+				std::cout << "Call " << stmt->name;
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Stdout: {
+				auto stmt = dynamic_cast<const Parser::StdoutStatement *>(&statement);
+				std::cout << "Stdout ";
+				PrintOperand(*stmt->source);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
 				}
+				break;
+			}
+			case StatementTag::StdoutText: {
+				auto stmt = dynamic_cast<const Parser::StdoutTextStatement *>(&statement);
+				std::cout << "StdoutText ";
+				std::cout << stmt->text;
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::StdoutBytes: {
+				auto stmt = dynamic_cast<const Parser::StdoutBytesStatement *>(&statement);
+				std::cout << "StdoutBytes [";
+				PrintRegister(stmt->address);
+				std::cout << "], ";
+				PrintOperand(*stmt->length);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Stdin: {
+				auto stmt = dynamic_cast<const Parser::RegisterStatement *>(&statement);
+				std::cout << "Stdin ";
+				PrintRegister(stmt->reg);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::MapFile: {
+				auto stmt = dynamic_cast<const Parser::MapFileStatement *>(&statement);
+				std::cout << "MapFile ";
+				PrintRegister(stmt->address);
+				std::cout << ", ";
+				PrintRegister(stmt->length);
+				std::cout << " = " << stmt->path;
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Push: {
+				auto stmt = dynamic_cast<const Parser::RegisterStatement *>(&statement);
+				std::cout << "Push ";
+				PrintRegister(stmt->reg);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
+			}
+			case StatementTag::Pop: {
+				auto stmt = dynamic_cast<const Parser::RegisterStatement *>(&statement);
+				std::cout << "Pop ";
+				PrintRegister(stmt->reg);
+				if (withCondition && stmt->condition.has_value()) {
+					std::cout << " if ";
+					PrintCondition(*stmt->condition);
+				}
+				break;
 			}
-			std::cout << '\n';
 		}
+		std::cout << '\n';
 	}
 	
 	void PrintRegister(const Register reg) {
@@ -480,7 +1465,18 @@ namespace Runtime {
 	
 	void PrintCondition(const Condition &condition) {
 		PrintOperand(*condition.a);
-		switch (condition.comp) {
+		PrintComparison(condition.comp);
+		PrintOperand(*condition.b);
+	}
+	
+	void PrintCondition(const Compiler::IR::Condition &condition) {
+		PrintValue(condition.a);
+		PrintComparison(condition.comp);
+		PrintValue(condition.b);
+	}
+	
+	void PrintComparison(const Comparison comp) {
+		switch (comp) {
 			case Comparison::LessThan: std::cout << " < ";
 				break;
 			case Comparison::LessEquals: std::cout << " <= ";
@@ -494,7 +1490,6 @@ namespace Runtime {
 			case Comparison::NotEquals: std::cout << " != ";
 				break;
 		}
-		PrintOperand(*condition.b);
 	}
 	
 	void PrintOperand(const Operand &operand) {
@@ -505,4 +1500,13 @@ namespace Runtime {
 				break;
 		}
 	}
+	
+	void PrintValue(const Compiler::IR::Value &value) {
+		switch (value.tag) {
+			case OperandTag::Register: PrintRegister(value.reg);
+				break;
+			case OperandTag::Immediate: std::cout << value.value;
+				break;
+		}
+	}
 }
\ No newline at end of file
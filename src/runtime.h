@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdio>
 #include <cinttypes>
 #include <iostream>
@@ -9,39 +10,220 @@
 
 #include "common.h"
 #include "compiler.h"
+#include "propagation.h"
+#include "ranges.h"
+#include <emmintrin.h>
+#include <fcntl.h>
+#include <csignal>
 #include <sys/mman.h>
+#include <unistd.h>
 
 namespace Runtime {
 	
 	struct Options {
 		static bool flag_dumpTokens;
 		static bool flag_dumpAst;
+		static bool flag_dumpIr;
 		static bool flag_dumpCode;
 		static bool flag_noExec;
+		static size_t outputBufferSize;
+		static bool flag_inlinePrint;
+		static size_t inputBufferSize;
+		static const char *outputPath;
+		static bool flag_freestanding;
+		static size_t stackSize;
+		static bool flag_hugeStack;
+		static size_t arenaSize;
+		static int optimizationLevel;
 	};
 	
+	/* NOTE Output written by the compiled code. Generated code appends to it
+	 * directly and calls ExtendOutput when it runs out of space. When the buffer
+	 * isn't open, Print falls back to stdio.
+	 *
+	 * With a file sink (fd isn't -1) the buffer is a shared mapping of the whole
+	 * output file, which grows in FILE_CHUNK steps and is truncated to the
+	 * written length when closed.
+	 *
+	 * A freestanding module keeps its own descriptor in its writable section
+	 * and flushes it to fd with write(2). A failed write leaves the errno in
+	 * error.
+	 */
+	struct OutputBuffer {
+		unsigned char *cursor;
+		unsigned char *end;
+		unsigned char *begin;
+		int fd;
+		int error;
+	};
+	
+	constexpr size_t FILE_CHUNK = 64 << 20;
+	
+	extern OutputBuffer output;
+	
+	// Two ASCII digits for every number from 0 to 99.
+	extern const char DIGIT_PAIRS[201];
+	
+	// Length of INT64_MIN in decimal, the longest number Print can produce.
+	constexpr size_t MAX_DECIMAL_LENGTH = 20;
+	
+	unsigned char *WriteDecimal(int64_t value, unsigned char *out);
+	
+	/* NOTE The compiled program runs on its own stack, with an inaccessible
+	 * guard page below it. Overflowing into the guard page is reported on a
+	 * separate signal stack and ends the process.
+	 */
+	struct ExecutionStack {
+		unsigned char *mapping;
+		size_t mappingSize;
+		unsigned char *guard;
+		unsigned char *top;
+	};
+	
+	constexpr size_t STACK_GUARD_SIZE = 4096;
+	constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+	constexpr size_t MIN_STACK_SIZE = 64 << 10;
+	
+	bool OpenStack(ExecutionStack &stack, size_t size, bool huge);
+	
+	void CloseStack(ExecutionStack &stack);
+	
+	/* NOTE Memory handed out by alloc statements. The whole arena is reserved up
+	 * front, so addresses never change, and pages are committed in ARENA_CHUNK
+	 * steps when the generated code finds the cursor past end. reset moves the
+	 * cursor back to begin and keeps the committed pages.
+	 */
+	struct Arena {
+		unsigned char *cursor;
+		unsigned char *end;
+		unsigned char *begin;
+		unsigned char *limit;
+	};
+	
+	constexpr size_t ARENA_CHUNK = 16 << 20;
+	constexpr int64_t ARENA_ALIGNMENT = 16;
+	
+	extern Arena arena;
+	
+	bool OpenArena(Arena &descriptor, size_t size);
+	
+	void GrowArena(unsigned char *required);
+	
+	void CloseArena(Arena &descriptor);
+	
+	/* NOTE Integer-keyed hash table behind the table statements, allocated from
+	 * the arena. Slots are probed linearly in groups of TABLE_GROUP, with one
+	 * control byte per slot: TABLE_EMPTY or 7 bits of the key's hash, so a
+	 * whole group is matched with a single SSE2 compare. Keys are never
+	 * removed. Growing allocates larger arrays from the arena and leaves the
+	 * old ones until the next reset, which also invalidates the table.
+	 */
+	struct TableSlot {
+		int64_t key;
+		int64_t value;
+	};
+	
+	struct HashTable {
+		uint8_t *control;
+		TableSlot *slots;
+		size_t mask;
+		size_t count;
+	};
+	
+	constexpr size_t TABLE_GROUP = 16;
+	constexpr size_t TABLE_INITIAL_CAPACITY = 64;
+	constexpr uint8_t TABLE_EMPTY = 0x80;
+	
+	HashTable *NewTable();
+	
+	void TableInsert(HashTable *table, int64_t key, int64_t value);
+	
+	int64_t TableLookup(HashTable *table, int64_t key);
+	
+	int64_t TableIncrement(HashTable *table, int64_t key, int64_t amount);
+	
+	/* NOTE Read-ahead buffer for stdin. It is followed by INPUT_PADDING zero
+	 * bytes, so the parser can load 16 bytes at a time past the end of data.
+	 */
+	struct InputBuffer {
+		unsigned char *cursor;
+		unsigned char *end;
+		unsigned char *begin;
+		size_t capacity;
+		bool eof;
+		bool interactive;
+	};
+	
+	extern InputBuffer input;
+	
+	constexpr size_t INPUT_PADDING = 16;
+	
+	int64_t ReadInteger(int64_t current);
+	
+	void OpenInput(size_t size);
+	
+	void CloseInput();
+	
+	/* NOTE A file mapped read-only by the mapfile statement. The struct is
+	 * returned in rax and rdx. A file that can't be mapped has a length of -1.
+	 * Mappings stay until the program finishes.
+	 */
+	struct MappedFile {
+		const unsigned char *data;
+		int64_t length;
+	};
+	
+	MappedFile MapFile(const char *path);
+	
+	void UnmapFiles();
 	
 	void Print(int64_t value);
 	
 	void Print(const char *text, size_t length);
 	
+	void OpenOutput(size_t size);
+	
+	bool OpenOutputFile(const char *path);
+	
+	void GrowOutputFile(size_t minimum);
+	
+	void ExtendOutput();
+	
+	void FlushOutput();
+	
+	void CloseOutput();
+	
+	bool OpenModuleOutput(OutputBuffer &descriptor, size_t size, const char *path);
+	
+	bool CloseModuleOutput(OutputBuffer &descriptor);
+	
 	int RunFile(char *filepath);
 	
 	void PrintLexResults(std::string_view filePrefix, const std::vector<std::unique_ptr<Lexer::Token>> &tokens);
 	
 	void PrintParseResults(std::string_view filePrefix, const std::unordered_map<std::string, std::vector<std::unique_ptr<Parser::Statement>>> &procedures);
 	
-	void PrintCompileResults(const std::basic_string<unsigned char> &machineCode, size_t entry);
+	void PrintIR(std::string_view filePrefix, const std::unordered_map<std::string, Compiler::IR::Procedure> &ir);
+	
+	void PrintCompileResults(const std::basic_string<unsigned char> &machineCode, size_t entry, size_t rodataPtr, size_t dataPtr, const std::vector<Compiler::PeepholeStats> &peephole);
 	
-	void ExecuteCompileResults(const std::basic_string<unsigned char> &machineCode, size_t entry);
+	bool ExecuteCompileResults(const std::basic_string<unsigned char> &machineCode, size_t entry, size_t rodataPtr, size_t dataPtr);
 	
 	void PrintStatements(std::string_view filePrefix, const std::vector<std::unique_ptr<Parser::Statement>> &statements, size_t level = 0);
 	
+	void PrintStatement(std::string_view filePrefix, const Parser::Statement &statement, size_t level, bool withCondition);
+	
 	void PrintRegister(Compiler::Register reg);
 	
 	void PrintOperation(Operation op);
 	
 	void PrintCondition(const Condition &condition);
 	
+	void PrintCondition(const Compiler::IR::Condition &condition);
+	
+	void PrintComparison(Comparison comp);
+	
 	void PrintOperand(const Operand &operand);
+	
+	void PrintValue(const Compiler::IR::Value &value);
 }
\ No newline at end of file
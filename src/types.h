@@ -29,20 +29,45 @@ namespace Compiler {
 		r15 = 0x0F,
 	};
 	
+	// Bit set of registers, indexed by register encoding.
+	using RegisterSet = uint16_t;
+	
+	constexpr RegisterSet ALL_REGISTERS = 0xFFEF; // Everything except rsp
+	
+	constexpr RegisterSet RegisterBit(const Register reg) {
+		return static_cast<RegisterSet>(1u << static_cast<uint8_t>(reg));
+	}
+	
 	enum class StatementTag {
 		Assignment, // AssignmentStatement
 		Shorthand,  // ShorthandStatement
 		Longhand,   // LonghandStatement
+		DivMod,     // DivModStatement
 		Loop,       // LoopStatement
 		Branch,     // BranchStatement
 		Break,      // Statement
 		Continue,   // Statement
 		Return,     // Statement
 		Call,       // CallStatement
-		Stdout,     // StdoutStatement
-		StdoutText, // StdoutTextStatement
-		Push,       // RegisterStatement
-		Pop,        // RegisterStatement
+		Stdout,      // StdoutStatement
+		StdoutText,  // StdoutTextStatement
+		StdoutBytes, // StdoutBytesStatement
+		Stdin,       // RegisterStatement
+		MapFile,     // MapFileStatement
+		Alloc,       // AllocStatement
+		Reset,       // Statement
+		Copy,        // CopyStatement
+		Fill,        // FillStatement
+		Compare,     // CompareStatement
+		Find,        // FindStatement
+		Table,       // RegisterStatement
+		Insert,      // TableStatement
+		Lookup,      // TableStatement
+		Increment,   // TableStatement
+		Rdtsc,       // RegisterStatement
+		Rdtscp,      // RegisterPairStatement
+		Push,        // RegisterStatement
+		Pop,         // RegisterStatement
 	};
 	
 	enum class OperandTag {